@@ -1,4 +1,17 @@
-QT += core gui
+QT = core
+
+# El lector y el escritor de BMP son nativos, por lo que el programa no necesita QtGui.
+# Con CONFIG += qtgui_respaldo se usa QImage para cargar BMP que no sean de 24 bits.
+qtgui_respaldo {
+    QT += gui
+    DEFINES += DESAFIO_QTGUI
+}
+# Con CONFIG += traza se compila la instrumentacion de tiempos y contadores (opcion --traza).
+traza {
+    DEFINES += DESAFIO_TRAZA
+}
+# El pico de memoria (opcion --memoria) se consulta con GetProcessMemoryInfo.
+win32: LIBS += -lpsapi
 CONFIG += console c++17
 CONFIG += c++17 cmdline
 
@@ -7,8 +20,30 @@ CONFIG += c++17 cmdline
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        benchmark.cpp \
         bmp.cpp \
-        main.cpp
+        buffers.cpp \
+        busqueda.cpp \
+        cacheoperaciones.cpp \
+        cadena.cpp \
+        codecbmp.cpp \
+        codificador.cpp \
+        contexto.cpp \
+        generador.cpp \
+        identificacion.cpp \
+        kernels.cpp \
+        lote.cpp \
+        main.cpp \
+        mascarabin.cpp \
+        memoria.cpp \
+        operaciones.cpp \
+        pool.cpp \
+        precarga.cpp \
+        reconstruccion.cpp \
+        recursos.cpp \
+        servicio.cpp \
+        streaming.cpp \
+        traza.cpp
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -16,5 +51,27 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
-    bmp.h
+    benchmark.h \
+    bmp.h \
+    buffers.h \
+    busqueda.h \
+    cacheoperaciones.h \
+    cadena.h \
+    codecbmp.h \
+    codificador.h \
+    contexto.h \
+    generador.h \
+    identificacion.h \
+    kernels.h \
+    lote.h \
+    mascarabin.h \
+    memoria.h \
+    operaciones.h \
+    pool.h \
+    precarga.h \
+    reconstruccion.h \
+    recursos.h \
+    servicio.h \
+    streaming.h \
+    traza.h
 
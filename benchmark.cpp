@@ -0,0 +1,165 @@
+#include "benchmark.h"
+#include "bmp.h"
+#include "cadena.h"
+#include "codificador.h"
+#include "generador.h"
+#include "identificacion.h"
+#include "kernels.h"
+#include "pool.h"
+#include "reconstruccion.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+// Ejecuta 'prueba' 'repeticiones' veces y retorna el menor tiempo, en milisegundos
+template <typename F>
+double medir(int repeticiones, F prueba)
+{
+    double mejor = 0.0;
+    for (int r = 0; r < repeticiones; r++)
+    {
+        chrono::steady_clock::time_point inicio = chrono::steady_clock::now();
+        prueba();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - inicio).count();
+        if (r == 0 || ms < mejor)
+        {
+            mejor = ms;
+        }
+    }
+    return mejor;
+}
+
+// Imprime una fila del resultado: prueba, nivel SIMD, bytes procesados, milisegundos y GB/s
+void reportar(ostream &salida, const char *prueba, size_t bytes, double ms)
+{
+    double gbs = ms > 0.0 ? (double)bytes / (ms * 1e6) : 0.0;
+    salida << prueba << "," << kernels::nombreNivel(kernels::nivelActual()) << "," << bytes << "," << ms << "," << gbs << endl;
+}
+}
+
+bool ejecutarBenchmark(const QString &rutaDirectorio, const parametrosGenerador &p, int repeticiones, int hilos, ostream &salida)
+{
+    /*
+     * @brief Mide el rendimiento de los kernels, de la carga de archivos y de la reconstruccion completa.
+     *
+     * Esta función genera un caso sintetico en 'rutaDirectorio' (ver generarCaso) y mide sobre el:
+     * cadenaCompilada::aplicar sobre la imagen completa (una rotacion, un desplazamiento y un XOR por
+     * separado, y los tres fusionados, secuencial y en el pool), verificarEnmascaramiento y
+     * candidatosConsistentes sobre la ventana de M0.txt, loadSeedMasking de M0.txt, loadPixels de I_D.bmp, la
+     * escritura de un archivo como M0.txt (escribirEnmascaramiento) y la reconstruccion completa (reconstruirCaso). De cada prueba se reporta el menor tiempo de 'repeticiones' ejecuciones.
+     *
+     * La salida es CSV, con la cabecera 'prueba,simd,bytes,ms,gbps', para poder comparar los resultados
+     * entre versiones; los bytes son los que procesa cada prueba (para los archivos, su tamaño).
+     *
+     * @param rutaDirectorio Directorio en el que se genera el caso.
+     * @param p Parametros del caso generado.
+     * @param repeticiones Cantidad de ejecuciones de cada prueba.
+     * @param hilos Hilos del pool de la reconstruccion (0: uno por nucleo).
+     * @param salida Flujo en el que se escriben los resultados.
+     *
+     * @return true si el caso se genero y la reconstruccion coincidio con la imagen esperada.
+     */
+
+    poolHilos pool(hilos);
+    ostringstream registro;
+    if (!generarCaso(rutaDirectorio, p, pool, registro))
+    {
+        salida << registro.str();
+        return false;
+    }
+
+    bmp bmp;
+    int ancho = 0;
+    int alto = 0;
+    unsigned char *ID = bmp.loadPixels(rutaDirectorio + "/I_D.bmp", ancho, alto);
+    unsigned char *IM = bmp.loadPixels(rutaDirectorio + "/I_M.bmp", ancho, alto);
+    unsigned char *M = bmp.loadPixels(rutaDirectorio + "/M.bmp", ancho, alto);
+    unsigned char *esperada = bmp.loadPixels(rutaDirectorio + "/I_O_esperada.bmp", ancho, alto);
+    const size_t totalBytes = (size_t)ancho * alto * 3;
+    unsigned char *destino = new unsigned char[totalBytes];
+    string nombreM0 = (rutaDirectorio + "/M0.txt").toStdString();
+    int seed = 0;
+    int n_pixels = 0;
+    unsigned short int *maskingData = bmp.loadSeedMasking(nombreM0.c_str(), seed, n_pixels);
+
+    salida << "prueba,simd,bytes,ms,gbps" << endl;
+
+    // Las mismas cadenas compiladas que aplica la reconstruccion: cada operacion sola y las tres fusionadas
+    // (en el nombre de la prueba las operaciones se separan con '+', para no romper el CSV)
+    const char *cadenas[][2] = {{"rotIzq:3", "rotIzq:3"}, {"despDer:3", "despDer:3"}, {"xor", "xor"}, {"rotIzq:3,xor,despDer:3", "rotIzq:3+xor+despDer:3"}};
+    cadenaCompilada compilada;
+    for (const auto &c : cadenas)
+    {
+        vector<candidato> cadena;
+        interpretarCadena(c[0], cadena);
+        compilada.compilar(cadena);
+        reportar(salida, c[1], totalBytes, medir(repeticiones, [&]() { compilada.aplicar(destino, ID, IM, totalBytes); }));
+    }
+    reportar(salida, "rotIzq:3+xor+despDer:3 pool", totalBytes, medir(repeticiones, [&]() { compilada.aplicar(destino, ID, IM, totalBytes, pool); }));
+
+    // M0.txt enmascara la imagen original, por lo que la verificacion recorre la ventana completa
+    bool verifica = false;
+    reportar(salida, "verificarEnmascaramiento", (size_t)n_pixels * 3, medir(repeticiones, [&]() { verifica = bmp.verificarEnmascaramiento(esperada, M, maskingData, seed, n_pixels); }));
+
+    // La identificacion de la misma ventana contra la ventana esperada: las rotaciones de 8 bits dejan la
+    // imagen original igual, por lo que siempre hay candidatos vivos y se recorre la ventana completa
+    unsigned char *preimagen = bmp.calcularPreimagen(M, maskingData, n_pixels);
+    mascaraCandidatos consistentes = 0;
+    reportar(salida, "candidatosConsistentes", (size_t)n_pixels * 3, medir(repeticiones, [&]() {
+                 consistentes = preimagen != nullptr ? candidatosConsistentes(esperada + seed, IM + seed, preimagen, (size_t)n_pixels * 3) : 0;
+             }));
+    verifica = verifica && consistentes != 0;
+    delete[] preimagen;
+
+    reportar(salida, "loadSeedMasking", (size_t)QFileInfo(QString(nombreM0.c_str())).size(), medir(repeticiones, [&]() {
+                 int s = 0;
+                 int n = 0;
+                 delete[] bmp.loadSeedMasking(nombreM0.c_str(), s, n);
+             }));
+    reportar(salida, "loadPixels", totalBytes, medir(repeticiones, [&]() {
+                 int w = 0;
+                 int h = 0;
+                 delete[] bmp.loadPixels(rutaDirectorio + "/I_D.bmp", w, h);
+             }));
+
+    // Escritura de un archivo de enmascaramiento como los que genera el codificador (con otro nombre, para
+    // que la reconstruccion no lo tome como una etapa)
+    QString nombrePrueba = rutaDirectorio + "/enmascaramiento_prueba.txt";
+    reportar(salida, "escribirEnmascaramiento", (size_t)QFileInfo(QString(nombreM0.c_str())).size(), medir(repeticiones, [&]() {
+                 escribirEnmascaramiento(nombrePrueba, esperada + seed, M, seed, n_pixels);
+             }));
+    QFile::remove(nombrePrueba);
+
+    // Reconstruccion completa, desde los archivos hasta I_O.bmp
+    bool reconstruido = false;
+    reportar(salida, "reconstruccion", totalBytes, medir(repeticiones, [&]() {
+                 ostringstream mensajes;
+                 reconstruido = reconstruirCaso(rutaDirectorio, rutaDirectorio + "/I_O.bmp", pool, mensajes);
+             }));
+
+    int w = 0;
+    int h = 0;
+    unsigned char *IO = bmp.loadPixels(rutaDirectorio + "/I_O.bmp", w, h);
+    bool correcto = verifica && reconstruido && IO != nullptr && memcmp(IO, esperada, totalBytes) == 0;
+    if (!correcto)
+    {
+        salida << "# la reconstruccion no coincide con I_O_esperada.bmp" << endl;
+    }
+
+    delete[] ID;
+    delete[] IM;
+    delete[] M;
+    delete[] esperada;
+    delete[] destino;
+    delete[] maskingData;
+    delete[] IO;
+    return correcto;
+}
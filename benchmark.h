@@ -0,0 +1,12 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+
+#include <ostream>
+
+struct parametrosGenerador;
+
+bool ejecutarBenchmark(const QString &rutaDirectorio, const parametrosGenerador &parametros, int repeticiones, int hilos, std::ostream &salida);
+
+#endif // BENCHMARK_H
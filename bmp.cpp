@@ -1,10 +1,14 @@
 #include "bmp.h"
+#include "codecbmp.h"
+#include "traza.h"
 
-#include <fstream>
 #include <iostream>
-#include <QCoreApplication>
-#include <QImage>
 #include <QDir>
+#include <QFile>
+#include <cstring>
+#ifdef DESAFIO_QTGUI
+#include <QImage>
+#endif
 
 using namespace std;
 
@@ -15,10 +19,11 @@ unsigned char *bmp::loadPixels(QString input, int &width, int &height)
     /*
      * @brief Carga una imagen BMP desde un archivo y extrae los datos de píxeles en formato RGB.
      *
-     * Esta función utiliza la clase QImage de Qt para abrir una imagen en formato BMP, convertirla al
-     * formato RGB888 (24 bits: 8 bits por canal), y copiar sus datos de píxeles a un arreglo dinámico
-     * de tipo unsigned char. El arreglo contendrá los valores de los canales Rojo, Verde y Azul (R, G, B)
-     * de cada píxel de la imagen, sin rellenos (padding).
+     * Esta función abre la imagen con el lector nativo de BMP de 24 bits (ver imagenBMP), que mapea el
+     * archivo en memoria y copia sus píxeles una sola vez a un arreglo dinámico de tipo unsigned char.
+     * El arreglo contendrá los valores de los canales Rojo, Verde y Azul (R, G, B) de cada píxel de la
+     * imagen, sin rellenos (padding). Si el proyecto se compila con DESAFIO_QTGUI, las imagenes en otros
+     * formatos se cargan con QImage como respaldo.
      *
      * @param input Ruta del archivo de imagen BMP a cargar (tipo QString).
      * @param width Parámetro de salida que contendrá el ancho de la imagen cargada (en píxeles).
@@ -29,38 +34,51 @@ unsigned char *bmp::loadPixels(QString input, int &width, int &height)
      * @note Es responsabilidad del usuario liberar la memoria asignada al arreglo devuelto usando `delete[]`.
      */
 
-    // Cargar la imagen BMP desde el archivo especificado (usando Qt)
-    QImage imagen(input);
+    // Cargar la imagen BMP desde el archivo especificado con el lector nativo
+    TRAZA_ALCANCE("loadPixels");
+    imagenBMP imagen;
+    if (imagen.abrir(input))
+    {
+        width = imagen.ancho();
+        height = imagen.alto();
+
+        // Reserva memoria dinámica y copia (una sola vez) los valores RGB de cada píxel
+        unsigned char *pixelData = new unsigned char[imagen.totalBytes()];
+        TRAZA_SUMAR(traza::RESERVAS, 1);
+        TRAZA_SUMAR(traza::BYTES_LEIDOS, imagen.totalBytes());
+        imagen.copiarRGB(pixelData);
+        return pixelData;
+    }
+
+#ifdef DESAFIO_QTGUI
+    // Respaldo para BMP que no son de 24 bits sin compresion (usando Qt)
+    QImage imagenQt(input);
 
     // Verifica si la imagen fue cargada correctamente
-    if (imagen.isNull())
+    if (imagenQt.isNull())
     {
         return nullptr; // Retorna un puntero nulo si la carga falló
     }
 
     // Convierte la imagen al formato RGB888 (3 canales de 8 bits sin transparencia)
-    imagen = imagen.convertToFormat(QImage::Format_RGB888);
+    imagenQt = imagenQt.convertToFormat(QImage::Format_RGB888);
 
     // Obtiene el ancho y el alto de la imagen cargada
-    width = imagen.width();
-    height = imagen.height();
-
-    // Calcula el tamaño total de datos (3 bytes por píxel: R, G, B)
-    int dataSize = width * height * 3;
+    width = imagenQt.width();
+    height = imagenQt.height();
 
     // Reserva memoria dinámica para almacenar los valores RGB de cada píxel
-    unsigned char *pixelData = new unsigned char[dataSize];
+    unsigned char *pixelData = new unsigned char[(size_t)width * height * 3];
 
     // Copia cada línea de píxeles de la imagen Qt a nuestro arreglo lineal
     for (int y = 0; y < height; ++y)
     {
-        const uchar *srcLine = imagen.scanLine(y);          // Línea original de la imagen con posible padding
-        unsigned char *dstLine = pixelData + y * width * 3; // Línea destino en el arreglo lineal sin padding
-        memcpy(dstLine, srcLine, width * 3);                // Copia los píxeles RGB de esa línea (sin padding)
+        memcpy(pixelData + (size_t)y * width * 3, imagenQt.scanLine(y), width * 3);
     }
-
-    // Retorna el puntero al arreglo de datos de píxeles cargado en memoria
     return pixelData;
+#else
+    return nullptr; // Retorna un puntero nulo si la carga falló
+#endif
 }
 
 bool bmp::exportImage(unsigned char *pixelData, int width, int height, QString archivoSalida)
@@ -68,10 +86,10 @@ bool bmp::exportImage(unsigned char *pixelData, int width, int height, QString a
     /*
      * @brief Exporta una imagen en formato BMP a partir de un arreglo de píxeles en formato RGB.
      *
-     * Esta función crea una imagen de tipo QImage utilizando los datos contenidos en el arreglo dinámico
-     * `pixelData`, que debe representar una imagen en formato RGB888 (3 bytes por píxel, sin padding).
-     * A continuación, copia los datos línea por línea a la imagen de salida y guarda el archivo resultante
-     * en formato BMP en la ruta especificada.
+     * Esta función escribe los datos contenidos en el arreglo dinámico `pixelData`, que debe representar
+     * una imagen en formato RGB888 (3 bytes por píxel, sin padding), como un archivo BMP de 24 bits. Las
+     * filas se escriben directamente en el archivo con el escritor nativo (ver escritorBMP), sin pasar
+     * por una copia intermedia de la imagen.
      *
      * @param pixelData Puntero a un arreglo de bytes que contiene los datos RGB de la imagen a exportar.
      *                  El tamaño debe ser igual a width * height * 3 bytes.
@@ -84,326 +102,190 @@ bool bmp::exportImage(unsigned char *pixelData, int width, int height, QString a
      * @note La función no libera la memoria del arreglo pixelData; esta responsabilidad recae en el usuario.
      */
 
-    // Crear una nueva imagen de salida con el mismo tamaño que la original
-    // usando el formato RGB888 (3 bytes por píxel, sin canal alfa)
-    QImage outputImage(width, height, QImage::Format_RGB888);
-
-    // Copiar los datos de píxeles desde el buffer al objeto QImage
-    for (int y = 0; y < height; ++y)
+    TRAZA_ALCANCE("exportImage");
+    escritorBMP salida;
+    if (!salida.abrir(archivoSalida, width, height))
     {
-        // outputImage.scanLine(y) devuelve un puntero a la línea y-ésima de píxeles en la imagen
-        // pixelData + y * width * 3 apunta al inicio de la línea y-ésima en el buffer (sin padding)
-        // width * 3 son los bytes a copiar (3 por píxel)
-        memcpy(outputImage.scanLine(y), pixelData + y * width * 3, width * 3);
+        return false; // Indica que la operación falló
     }
 
-    // Guardar la imagen en disco como archivo BMP
-    if (!outputImage.save(archivoSalida, "BMP"))
+    // Escribir todas las filas y cerrar el archivo
+    salida.escribirFilas(0, height, pixelData);
+    return salida.cerrar();
+}
+
+namespace
+{
+// Lee un entero sin signo desde 'p' (sin pasar de 'fin'). Retorna false si no hay digitos o si el
+// valor no cabe en 'maximo'.
+bool leerEntero(const char *&p, const char *fin, unsigned int maximo, unsigned int &valor)
+{
+    const char *inicio = p;
+    unsigned long long acumulado = 0;
+    while (p < fin && *p >= '0' && *p <= '9')
     {
-        return false; // Indica que la operación falló
+        acumulado = acumulado * 10 + (*p - '0');
+        if (acumulado > maximo)
+        {
+            return false;
+        }
+        p++;
     }
-    else
+    valor = (unsigned int)acumulado;
+    return p != inicio;
+}
+
+bool esEspacio(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Avanza 'p' hasta el siguiente caracter que no es espacio en blanco, contando los saltos de linea
+void saltarEspacios(const char *&p, const char *fin, int &linea)
+{
+    while (p < fin && esEspacio(*p))
     {
-        return true; // Indica éxito
+        linea += *p == '\n';
+        p++;
     }
 }
+}
 
-unsigned int *bmp::loadSeedMasking(const char *nombreArchivo, int &seed, int &n_pixels)
+unsigned short int *bmp::loadSeedMasking(const char *nombreArchivo, int &seed, int &n_pixels)
 {
     /*
      * @brief Carga la semilla y los resultados del enmascaramiento desde un archivo de texto.
      *
-     * Esta función abre un archivo de texto que contiene una semilla en la primera línea y,
-     * a continuación, una lista de valores RGB resultantes del proceso de enmascaramiento.
-     * Primero cuenta cuántos tripletes de píxeles hay, luego reserva memoria dinámica
-     * y finalmente carga los valores en un arreglo de enteros.
+     * Esta función mapea en memoria un archivo de texto que contiene una semilla en la primera línea y,
+     * a continuación, una línea con los tres valores R G B resultantes del enmascaramiento por cada píxel.
+     * Como con la lectura con >>, los valores pueden separarse con cualquier espacio en blanco, de modo
+     * que un triplete puede ocupar varias líneas. El archivo se recorre una sola vez: cada valor se
+     * convierte con un lector de dígitos propio y se agrega a un arreglo de 16 bits que crece a medida
+     * que se necesita (cada valor es la suma de dos bytes, por lo que no puede superar 510).
      *
      * @param nombreArchivo Ruta del archivo de texto que contiene la semilla y los valores RGB.
      * @param seed Variable de referencia donde se almacenará el valor entero de la semilla.
      * @param n_pixels Variable de referencia donde se almacenará la cantidad de píxeles leídos
      *                 (equivalente al número de líneas después de la semilla).
      *
-     * @return Puntero a un arreglo dinámico de enteros que contiene los valores RGB
-     *         en orden secuencial (R, G, B, R, G, B, ...). Devuelve nullptr si ocurre un error al abrir el archivo.
+     * @return Puntero a un arreglo dinámico que contiene los valores RGB en orden secuencial
+     *         (R, G, B, R, G, B, ...). Devuelve nullptr si el archivo no puede abrirse, si algún valor
+     *         está mal formado o es mayor que 510, o si el último píxel está incompleto; en ese caso se
+     *         informa por cerr la línea y la posición (en bytes) del valor.
      *
      * @note Es responsabilidad del usuario liberar la memoria reservada con delete[].
      */
 
-    // Abrir el archivo que contiene la semilla y los valores RGB
-    ifstream archivo(nombreArchivo);
-    if (!archivo.is_open())
+    // Abrir y mapear en memoria el archivo que contiene la semilla y los valores RGB
+    TRAZA_ALCANCE("loadSeedMasking");
+    QFile archivo(nombreArchivo);
+    if (!archivo.open(QIODevice::ReadOnly) || archivo.size() == 0)
     {
-        // Verificar si el archivo pudo abrirse correctamente
-        // cout << "No se pudo abrir el archivo." << endl;
         return nullptr;
     }
-
-    // Leer la semilla desde la primera línea del archivo
-    archivo >> seed;
-
-    int r, g, b;
-
-    // Contar cuántos grupos de valores RGB hay en el archivo
-    // Se asume que cada línea después de la semilla tiene tres valores (r, g, b)
-    while (archivo >> r >> g >> b)
-    {
-        n_pixels++; // Contamos la cantidad de píxeles
-    }
-
-    // Cerrar el archivo para volver a abrirlo desde el inicio
-    archivo.close();
-    archivo.open(nombreArchivo);
-
-    // Verificar que se pudo reabrir el archivo correctamente
-    if (!archivo.is_open())
+    qint64 tamano = archivo.size();
+    const char *texto = (const char *)archivo.map(0, tamano);
+    if (texto == nullptr)
     {
         return nullptr;
     }
-
-    // Reservar memoria dinámica para guardar todos los valores RGB
-    // Cada píxel tiene 3 componentes: R, G y B
-    unsigned int *RGB = new unsigned int[n_pixels * 3];
-
-    // Leer nuevamente la semilla desde el archivo (se descarta su valor porque ya se cargó antes)
-    archivo >> seed;
-
-    // Leer y almacenar los valores RGB uno por uno en el arreglo dinámico
-    for (int i = 0; i < n_pixels * 3; i += 3)
-    {
-        archivo >> r >> g >> b;
-        RGB[i] = r;
-        RGB[i + 1] = g;
-        RGB[i + 2] = b;
-    }
-
-    // Cerrar el archivo después de terminar la lectura
-    archivo.close();
-
-    // Retornar el puntero al arreglo con los datos RGB
-    return RGB;
-}
-
-unsigned char *bmp::copiarArreglo(unsigned char *IT, unsigned int totalBytes)
-{
-    /*
-     * @brief Copia la informacion de un arreglo a otro almacenado en el heap.
-     *
-     * Esta función crea un arreglo dinámico 'ID', que copia la informacion del arreglo 'IT'.
-     *
-     * @param IT Puntero a un arreglo dinamico.
-     * @param totalBytes Tamaño del arreglo.
-     *
-     * @return Puntero al nuevo arreglo dinámico que contiene la copia de los datos de 'IT'.
-     *
-     * @note La función no libera la memoria del arreglo IT; esta responsabilidad recae en el usuario.
-     */
-
-    // Reserva memoria dinamica para almacenar la copia de 'IT'
-    unsigned char *ID = new unsigned char[totalBytes];
-
-    // Copiar la informacion de 'IT' a 'ID'
-    for (unsigned int i = 0; i < totalBytes; i++)
+    const char *p = texto;
+    const char *fin = texto + tamano;
+
+    // Cada pixel ocupa al menos 6 bytes ("0 0 0\n"), lo que da una primera estimacion de la capacidad
+    size_t capacidad = tamano / 6 * 3 + 3;
+    size_t cantidad = 0;
+    unsigned short int *RGB = new unsigned short int[capacidad];
+    TRAZA_SUMAR(traza::RESERVAS, 1);
+    TRAZA_SUMAR(traza::BYTES_LEIDOS, tamano);
+
+    int linea = 1;
+    bool leyoSemilla = false;
+    unsigned int valores[3];
+    int leidos = 0;
+    while (true)
     {
-        ID[i] = IT[i];
-    }
-
-    // Retorna el puntero al arreglo con los datos de 'IT' copiados
-    return ID;
-}
-
-unsigned char *bmp::rotarIzquierda(unsigned char *ID, unsigned short int bits, unsigned int totalBytes)
-{
-    /*
-     * @brief Rota el arreglo 'ID' y lo almacena en un arreglo almacenado en el heap.
-     *
-     * Esta función copia el arreglo dinámico 'ID' a 'transformacion' y, rota cada byte del arreglo
-     * una cantidad n (bits) de bits a la izquierda.
-     *
-     * @param ID Puntero a un arreglo dinamico con los valores RGB de la imagen BMP.
-     * @param bits Cantidad de bits a rotar.
-     * @param totalBytes Tamaño del arreglo.
-     *
-     * @return Puntero al nuevo arreglo dinámico que contiene la rotacion de 'ID'.
-     *
-     * @note La función no libera la memoria del arreglo ID; esta responsabilidad recae en el usuario.
-     */
-
-    // Copia 'ID' a 'transformacion' invocando la funcion copiar arreglo
-    unsigned char *transformacion = copiarArreglo(ID, totalBytes);
-
-    // Itera sobre 'transformacion' para rotar cada byte
-    for (unsigned int t = 0; t < totalBytes; t++)
-    {
-        // Rota cada byte a la izquierda la cantidad de veces que se requiere
-        for (int i = 0; i < bits; ++i)
+        saltarEspacios(p, fin, linea);
+        if (p == fin)
         {
-            unsigned char bit = (transformacion[t] & 0b10000000) >> 7;
-            transformacion[t] = (transformacion[t] << 1) | bit;
+            break;
         }
-    }
-
-    // Retorna el puntero al arreglo con los datos de 'ID' rotados
-    return transformacion;
-}
 
-unsigned char *bmp::rotarDerecha(unsigned char *ID, unsigned short int bits, unsigned int totalBytes)
-{
-    /*
-     * @brief Rota el arreglo 'ID' y lo almacena en un arreglo almacenado en el heap.
-     *
-     * Esta función copia el arreglo dinámico 'ID' a 'transformacion' y, rota cada byte del arreglo
-     * una cantidad n (bits) de bits a la derecha.
-     *
-     * @param ID Puntero a un arreglo dinamico con los valores RGB de la imagen BMP.
-     * @param bits Cantidad de bits a rotar.
-     * @param totalBytes Tamaño del arreglo.
-     *
-     * @return Puntero al nuevo arreglo dinámico que contiene la rotacion de 'ID'.
-     *
-     * @note La función no libera la memoria del arreglo ID; esta responsabilidad recae en el usuario.
-     */
+        // Cada valor son solo digitos, seguidos de un espacio en blanco o del final del archivo
+        const char *inicioValor = p;
+        unsigned int valor;
+        if (!leerEntero(p, fin, leyoSemilla ? 510 : 0x7FFFFFFF, valor) || (p < fin && !esEspacio(*p)))
+        {
+            cerr << nombreArchivo << ": linea " << linea << " (byte " << (inicioValor - texto) << ") mal formada" << endl;
+            delete[] RGB;
+            return nullptr;
+        }
 
-    // Copia 'ID' a 'transformacion' invocando la funcion copiar arreglo
-    unsigned char *transformacion = copiarArreglo(ID, totalBytes);
+        if (!leyoSemilla)
+        {
+            seed = valor;
+            leyoSemilla = true;
+            continue;
+        }
 
-    // Itera sobre 'transformacion' para rotar cada byte
-    for (unsigned int t = 0; t < totalBytes; t++)
-    {
-        // Rota cada byte a la derecha la cantidad de veces que se requiere
-        for (int i = 0; i < bits; ++i)
+        valores[leidos++] = valor;
+        if (leidos == 3)
         {
-            unsigned char bit = (transformacion[t] & 0b00000001) << 7;
-            transformacion[t] = (transformacion[t] >> 1) | bit;
+            // Se duplica la capacidad cuando el arreglo se llena
+            if (cantidad + 3 > capacidad)
+            {
+                capacidad *= 2;
+                unsigned short int *mayor = new unsigned short int[capacidad];
+                TRAZA_SUMAR(traza::RESERVAS, 1);
+                memcpy(mayor, RGB, cantidad * sizeof(unsigned short int));
+                delete[] RGB;
+                RGB = mayor;
+            }
+            RGB[cantidad++] = valores[0];
+            RGB[cantidad++] = valores[1];
+            RGB[cantidad++] = valores[2];
+            leidos = 0;
         }
     }
 
-    // Retorna el puntero al arreglo con los datos de 'ID' rotados
-    return transformacion;
-}
-
-unsigned char *bmp::XOR(unsigned char *ID)
-{
-    /*
-     * @brief Aplica una operación XOR al arreglo 'ID' usando una máscara cargada desde archivo.
-     *
-     * Esta función recibe el arreglo dinámico 'ID', luego carga la máscara 'IM' en un arreglo dinámico,
-     * y aplica una operación XOR entre ambos arreglos. El resultado se almacena en un nuevo arreglo
-     * dinámico llamado 'transformacion'.
-     *
-     * @param ID Puntero a un arreglo dinámico con los valores RGB de la imagen BMP.
-     *
-     * @return Puntero al nuevo arreglo dinámico que contiene el resultado del XOR entre 'ID' e 'IM'.
-     *
-     * @note La función no libera la memoria del arreglo 'ID'; esta responsabilidad recae en el usuario.
-     */
-
-    // Se carga IM
-    QString I_M = "../../data/I_M.bmp";
-    int height_IM = 0;
-    int width_IM = 0;
-    unsigned char *IM = loadPixels(I_M, width_IM, height_IM);
-
-    // Reserva memoria dinamica para almacenar el XOR de 'ID' con 'IM'
-    unsigned char *transformacion = new unsigned char[height_IM * width_IM * 3];
-
-    // Itera sobre el tamaño de 'IM' y aplica el XOR en cada byte
-    for (int i = 0; i < height_IM * width_IM * 3; i++)
+    if (!leyoSemilla)
     {
-        transformacion[i] = ID[i] ^ IM[i];
+        cerr << nombreArchivo << ": no contiene la semilla" << endl;
+        delete[] RGB;
+        return nullptr;
     }
 
-    // Libera la memoria de 'IM'
-    delete[] IM;
-
-    // Retorna el puntero al arreglo con el resultado del XOR entre 'ID' e 'IM'
-    return transformacion;
-}
-
-unsigned char *bmp::desplazamientoDerecha(unsigned char *ID, unsigned short int bits, unsigned int totalBytes)
-{
-    /*
-     * @brief Desplaza a la derecha el arreglo 'ID' y lo almacena en un arreglo almacenado en el heap.
-     *
-     * Esta función desplaza a la derecha cada byte del arreglo 'ID' una cantidad n (bits) de bits a la derecha.
-     *
-     * @param ID Puntero a un arreglo dinamico con los valores RGB de la imagen BMP.
-     * @param bits Cantidad de bits a desplazar.
-     * @param totalBytes Tamaño del arreglo.
-     *
-     * @return Puntero al nuevo arreglo dinámico que contiene el desplazamiento de 'ID'.
-     *
-     * @note La función no libera la memoria del arreglo ID; esta responsabilidad recae en el usuario.
-     */
-
-    // Reserva memoria dinamica para almacenar el desplazamiento de 'ID'
-    unsigned char *transformacion = new unsigned char[totalBytes];
-
-    // Desplaza a la derecha cada byte de 'ID' y lo almacena en transformacion
-    for (unsigned int i = 0; i < totalBytes; ++i)
+    if (leidos != 0)
     {
-        transformacion[i] = ID[i] >> bits;
+        cerr << nombreArchivo << ": el ultimo pixel tiene " << leidos << " de sus 3 valores" << endl;
+        delete[] RGB;
+        return nullptr;
     }
 
-    // Retorna el puntero al arreglo con los datos de 'ID' desplazados
-    return transformacion;
-}
-
-unsigned char *bmp::desplazamientoIzquierda(unsigned char *ID, unsigned short int bits, unsigned int totalBytes)
-{
-    /*
-     * @brief Desplaza a la izquierda el arreglo 'ID' y lo almacena en un arreglo almacenado en el heap.
-     *
-     * Esta función desplaza  a la izquierda cada byte del arreglo 'ID' una cantidad n (bits) de bits a la derecha.
-     *
-     * @param ID Puntero a un arreglo dinamico con los valores RGB de la imagen BMP.
-     * @param bits Cantidad de bits a desplazar.
-     * @param totalBytes Tamaño del arreglo.
-     *
-     * @return Puntero al nuevo arreglo dinámico que contiene el desplazamiento de 'ID'.
-     *
-     * @note La función no libera la memoria del arreglo ID; esta responsabilidad recae en el usuario.
-     */
-
-    // Reserva memoria dinamica para almacenar el desplazamiento de 'ID'
-    unsigned char *transformacion = new unsigned char[totalBytes];
+    n_pixels = cantidad / 3;
 
-    // Desplaza a la izquierda cada byte de 'ID' y lo almacena en transformacion
-    for (unsigned int i = 0; i < totalBytes; ++i)
-    {
-        transformacion[i] = ID[i] << bits & 0xFF;
-    }
-
-    // Retorna el puntero al arreglo con los datos de 'ID' desplazados
-    return transformacion;
+    // Retornar el puntero al arreglo con los datos RGB
+    return RGB;
 }
 
-bool bmp::verificarEnmascaramiento(unsigned char *ID, const char *name)
+bool bmp::verificarEnmascaramiento(unsigned char *ID, const unsigned char *mascara, const unsigned short int *maskingData, int seed, int n_pixels)
 {
     /*
-     * @brief Valida que la transformacion sea la adecuada.
+     * @brief Valida que la transformacion sea la adecuada usando datos ya cargados en memoria.
      *
-     *Esta función carga una máscara BMP 'IM' y un archivo de datos .txt 'maskingData' en arreglos dinámicos.
-     *Luego, aplica una la funcion por enmascaramiento con el arreglo 'ID' y verifica que el resultado coincida
-     *con los valores esperados almacenados en el archivo de texto.
+     * Esta función recibe la mascara 'M' y los datos del archivo .txt por referencia, de modo que se
+     * cargan una sola vez por ejecucion.
      *
      * @param ID Puntero a un arreglo dinámico con los valores RGB de la imagen BMP.
-     * @param name Nombre del archivo .txt.
+     * @param mascara Puntero al arreglo con los valores RGB de la mascara 'M'.
+     * @param maskingData Resultados del enmascaramiento leidos del archivo .txt.
+     * @param seed Posicion inicial del enmascaramiento dentro de 'ID'.
+     * @param n_pixels Cantidad de pixeles enmascarados.
      *
      * @return true si todos los valores transformados coinciden con los esperados; false en caso contrario.
-     *
-     * @note La función no libera la memoria del arreglo 'ID'; esta responsabilidad recae en el usuario.
      */
 
-    // Se carga la mascara
-    QString M = "../../data/M.bmp";
-    int height_M = 0;
-    int width_M = 0;
-    unsigned char *mascara = loadPixels(M, width_M, height_M);
-
-    // Se abre el archivo .txt
-    int seed = 0;
-    int n_pixels = 0;
-    unsigned int *maskingData = loadSeedMasking(name, seed, n_pixels);
+    TRAZA_ALCANCE("verificarEnmascaramiento");
 
     // Se itera sobre el arreglo 'maskingData' que contiene la informacion del archivo .txt
     for(int k = 0; k < n_pixels*3;k++){
@@ -412,19 +294,50 @@ bool bmp::verificarEnmascaramiento(unsigned char *ID, const char *name)
 
         // Valida si la transformacion no es igual al resultado almacenado en 'maskingData'
         if(maskingData[k] != enmascaramiento){
-            // Se librera 'maskingData' y 'mascara' y se retorna falso dado que todos los valores transformados no son iguales a los esperados
-            delete[] maskingData;
-            delete[] mascara;
+            // Se retorna falso dado que todos los valores transformados no son iguales a los esperados
+            TRAZA_SUMAR(traza::BYTES_VERIFICADOS, k + 1);
             return false;
         }
     }
-    // Se libera 'maskingData' y 'mascara' y se retorna true dado que todos los valores transformados son iguales a los esperados
-    delete[] maskingData;
-    delete[] mascara;
+    // Se retorna true dado que todos los valores transformados son iguales a los esperados
+    TRAZA_SUMAR(traza::BYTES_VERIFICADOS, n_pixels * 3);
     return true;
 }
 
-int bmp::contarArchivosMascara(const QString &rutaDirectorio)
+unsigned char *bmp::calcularPreimagen(const unsigned char *mascara, const unsigned short int *maskingData, int n_pixels)
+{
+    /*
+     * @brief Calcula la ventana que debe tener la imagen para que su enmascaramiento coincida con 'maskingData'.
+     *
+     * Como cada valor del archivo es la suma de un byte de la imagen y uno de la mascara, la ventana
+     * esperada es maskingData[k] - mascara[k]. Con ella, verificar un candidato es comparar dos arreglos
+     * de bytes (ver candidatosConsistentes) en lugar de sumar y comparar contra valores de 16 bits.
+     *
+     * @param mascara Puntero al arreglo con los valores RGB de la mascara 'M'.
+     * @param maskingData Resultados del enmascaramiento leidos del archivo .txt.
+     * @param n_pixels Cantidad de pixeles enmascarados.
+     *
+     * @return Arreglo dinámico de n_pixels*3 bytes, o nullptr si algun valor no puede obtenerse con un
+     *         byte (menor que el de la mascara o mayor en mas de 255), en cuyo caso ningun candidato verifica.
+     *
+     * @note Es responsabilidad del usuario liberar la memoria reservada con delete[].
+     */
+
+    unsigned char *esperado = new unsigned char[n_pixels * 3 > 0 ? n_pixels * 3 : 1];
+    for (int k = 0; k < n_pixels * 3; k++)
+    {
+        int diferencia = (int)maskingData[k] - (int)mascara[k];
+        if (diferencia < 0 || diferencia > 255)
+        {
+            delete[] esperado;
+            return nullptr;
+        }
+        esperado[k] = (unsigned char)diferencia;
+    }
+    return esperado;
+}
+
+int bmp::contarArchivosMascara(const QString &rutaDirectorio, const QString &patron)
 {
     /*
      * @brief Cuenta la cantidad de archivos de texto con nombre que inicia por 'M' en un directorio dado.
@@ -433,15 +346,16 @@ int bmp::contarArchivosMascara(const QString &rutaDirectorio)
      * cuyo nombre comienza con 'M' y tiene extensión '.txt'.
      *
      * @param rutaDirectorio Ruta del directorio a explorar.
+     * @param patron Patron de los archivos a contar ('M*.txt' por defecto, 'M*.bin' para el formato binario).
      *
-     * @return Número de archivos encontrados que cumplen con el patrón 'M*.txt'.
+     * @return Número de archivos encontrados que cumplen con el patrón.
      */
 
     // Carga el directorio
     QDir directorio(rutaDirectorio);
 
     // Genera una lista con los archivos que comiencen por 'M' y terminen por '.txt'
-    QStringList archivos = directorio.entryList(QStringList() << "M*.txt", QDir::Files);
+    QStringList archivos = directorio.entryList(QStringList() << patron, QDir::Files);
 
     // Retorna el tamaño de la lista (Cantidad de archivos que comiencen por 'M' y terminen por '.txt')
     return archivos.size();
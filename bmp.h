@@ -10,15 +10,10 @@ public:
 
     unsigned char *loadPixels(QString input, int &width, int &height);
     bool exportImage(unsigned char *pixelData, int width, int height, QString archivoSalida);
-    unsigned int *loadSeedMasking(const char *nombreArchivo, int &seed, int &n_pixels);
-    unsigned char *copiarArreglo(unsigned char *IT, unsigned int totalBytes);
-    unsigned char *rotarIzquierda(unsigned char *ID, unsigned short int bits, unsigned int totalBytes);
-    unsigned char *rotarDerecha(unsigned char *ID, unsigned short int bits, unsigned int totalBytes);
-    unsigned char *XOR(unsigned char *ID);
-    unsigned char* desplazamientoIzquierda(unsigned char* ID, unsigned short int bits, unsigned int totalBytes);
-    unsigned char* desplazamientoDerecha(unsigned char* ID, unsigned short int bits, unsigned int totalBytes);
-    bool verificarEnmascaramiento(unsigned char *ID, const char* name);
-    int contarArchivosMascara(const QString& rutaDirectorio);
+    unsigned short int *loadSeedMasking(const char *nombreArchivo, int &seed, int &n_pixels);
+    bool verificarEnmascaramiento(unsigned char *ID, const unsigned char *mascara, const unsigned short int *maskingData, int seed, int n_pixels);
+    unsigned char *calcularPreimagen(const unsigned char *mascara, const unsigned short int *maskingData, int n_pixels);
+    int contarArchivosMascara(const QString& rutaDirectorio, const QString &patron = "M*.txt");
 };
 
 #endif // BMP_H
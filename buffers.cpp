@@ -0,0 +1,119 @@
+#include "buffers.h"
+#include "traza.h"
+
+using namespace std;
+
+poolBuffers::poolBuffers() : reservas(0), reservados(0)
+{
+}
+
+poolBuffers::~poolBuffers()
+{
+    for (bloque &b : bloques)
+    {
+        delete[] b.datos;
+    }
+}
+
+unsigned char *poolBuffers::obtener(size_t bytes)
+{
+    /*
+     * @brief Entrega un arreglo de al menos 'bytes' bytes.
+     *
+     * Esta función reutiliza el arreglo libre mas pequeño que alcance; solo si no hay ninguno reserva
+     * uno nuevo con new[]. Es segura para usarse desde varios hilos.
+     *
+     * @param bytes Tamaño minimo del arreglo.
+     *
+     * @return Puntero al arreglo, que debe devolverse con devolver().
+     *
+     * @note El contenido del arreglo no se inicializa.
+     */
+
+    lock_guard<mutex> bloqueo(candado);
+    bloque *elegido = nullptr;
+    for (bloque &b : bloques)
+    {
+        if (b.libre && b.bytes >= bytes && (elegido == nullptr || b.bytes < elegido->bytes))
+        {
+            elegido = &b;
+        }
+    }
+    if (elegido != nullptr)
+    {
+        elegido->libre = false;
+        return elegido->datos;
+    }
+
+    bloque nuevo = {new unsigned char[bytes > 0 ? bytes : 1], bytes, false};
+    TRAZA_SUMAR(traza::RESERVAS, 1);
+    bloques.push_back(nuevo);
+    reservas++;
+    reservados += bytes;
+    return nuevo.datos;
+}
+
+void poolBuffers::devolver(unsigned char *buffer)
+{
+    /*
+     * @brief Marca como libre un arreglo entregado por obtener() (o adoptado), para reutilizarlo.
+     */
+
+    lock_guard<mutex> bloqueo(candado);
+    for (bloque &b : bloques)
+    {
+        if (b.datos == buffer)
+        {
+            b.libre = true;
+            return;
+        }
+    }
+}
+
+void poolBuffers::adoptar(unsigned char *buffer, size_t bytes)
+{
+    /*
+     * @brief Incorpora al pool un arreglo reservado afuera con new[] (por ejemplo, el de loadPixels).
+     *
+     * El arreglo queda en uso; el pool lo libera con delete[] cuando se destruye o se vacia.
+     */
+
+    lock_guard<mutex> bloqueo(candado);
+    bloque nuevo = {buffer, bytes, false};
+    bloques.push_back(nuevo);
+    reservados += bytes;
+}
+
+void poolBuffers::vaciar()
+{
+    /*
+     * @brief Libera los arreglos que no estan en uso.
+     */
+
+    lock_guard<mutex> bloqueo(candado);
+    for (size_t i = 0; i < bloques.size();)
+    {
+        if (bloques[i].libre)
+        {
+            reservados -= bloques[i].bytes;
+            delete[] bloques[i].datos;
+            bloques.erase(bloques.begin() + i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+size_t poolBuffers::cantidadReservas() const
+{
+    lock_guard<mutex> bloqueo(candado);
+    return reservas;
+}
+
+size_t poolBuffers::bytesReservados() const
+{
+    lock_guard<mutex> bloqueo(candado);
+    return reservados;
+}
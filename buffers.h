@@ -0,0 +1,41 @@
+#ifndef BUFFERS_H
+#define BUFFERS_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Pool de arreglos reutilizables. Los arreglos devueltos se guardan para la siguiente solicitud, de modo
+// que la cantidad de reservas en el heap no crece con la cantidad de etapas ni de candidatos.
+class poolBuffers
+{
+public:
+    poolBuffers();
+    ~poolBuffers();
+
+    unsigned char *obtener(size_t bytes);
+    void devolver(unsigned char *buffer);
+    void adoptar(unsigned char *buffer, size_t bytes);
+    void vaciar();
+
+    size_t cantidadReservas() const;
+    size_t bytesReservados() const;
+
+private:
+    struct bloque
+    {
+        unsigned char *datos;
+        size_t bytes;
+        bool libre;
+    };
+
+    poolBuffers(const poolBuffers &) = delete;
+    poolBuffers &operator=(const poolBuffers &) = delete;
+
+    std::vector<bloque> bloques;
+    mutable std::mutex candado;
+    size_t reservas;
+    size_t reservados;
+};
+
+#endif // BUFFERS_H
@@ -0,0 +1,246 @@
+#include "busqueda.h"
+#include "buffers.h"
+#include "cacheoperaciones.h"
+#include "cadena.h"
+#include "contexto.h"
+#include "operaciones.h"
+#include "pool.h"
+#include "traza.h"
+
+#include <unordered_set>
+
+using namespace std;
+
+namespace
+{
+// Una rama de la busqueda: las operaciones elegidas hasta una etapa y su cadena compilada
+struct rama
+{
+    vector<int> ganadores; // Como en identificarCadena: el elemento k es la etapa n-k
+    cadenaCompilada compilada;
+};
+
+// Todos los pares (byte, byte de I_M), para evaluar una cadena en todo su dominio
+struct dominioCompleto
+{
+    unsigned char valores[256 * 256];
+    unsigned char valoresIM[256 * 256];
+
+    dominioCompleto()
+    {
+        for (int k = 0; k < 256 * 256; k++)
+        {
+            valores[k] = (unsigned char)(k & 255);
+            valoresIM[k] = (unsigned char)(k >> 8);
+        }
+    }
+};
+
+unsigned long long huellaFuncion(const cadenaCompilada &compilada, poolBuffers &buffers)
+{
+    /*
+     * @brief Huella de la funcion que calcula una cadena compilada.
+     *
+     * Como cada byte del resultado depende solo del byte de entrada y del de I_M en su posicion, dos
+     * cadenas con la misma tabla de 256x256 valores transforman igual cualquier imagen: desde ahi, sus
+     * ramas de la busqueda son identicas.
+     */
+
+    static const dominioCompleto dominio;
+    unsigned char *tabla = buffers.obtener(sizeof(dominio.valores));
+    compilada.aplicar(tabla, dominio.valores, dominio.valoresIM, sizeof(dominio.valores));
+    unsigned long long huella = huellaBytes(tabla, sizeof(dominio.valores));
+    buffers.devolver(tabla);
+    return huella;
+}
+
+string describirCadena(const vector<int> &ganadores)
+{
+    string texto;
+    for (size_t k = 0; k < ganadores.size(); k++)
+    {
+        texto += (k > 0 ? ", " : "") + describirCandidato(obtenerCandidato(ganadores[k]));
+    }
+    return texto;
+}
+}
+
+vector<vector<int>> buscarCadenas(const lectorVentana &leer, const contexto &ctx, poolHilos &pool, poolBuffers &buffers, estadisticasBusqueda &estadisticas,
+                                  cacheOperaciones *operaciones)
+{
+    /*
+     * @brief Busca todas las cadenas de operaciones que explican las ventanas de todas las etapas.
+     *
+     * identificarCadena se queda con el primer candidato consistente de cada etapa; si hay varios (por
+     * ejemplo, por un desplazamiento que pierde bits o por una ventana muy chica) puede elegir uno que
+     * no explica las etapas anteriores, y entonces esas etapas ya no se identifican. Esta función, en
+     * cambio, mantiene todas las ramas: en cada etapa (de la ultima a la primera) evalua en paralelo,
+     * con identificarVentanaCache, la ventana de la etapa transformada por la cadena de cada rama, y
+     * cada candidato consistente da una rama para la etapa siguiente. Asi, los datos de enmascaramiento
+     * de cada etapa podan las ramas que no los explican.
+     *
+     * Las ramas que llegan a la misma funcion (ver huellaFuncion), como una rotacion a la izquierda de 3
+     * bits y una a la derecha de 5, se unen: de ahi en adelante solo se explora la primera. Las ramas
+     * se recorren en el orden de los candidatos, de modo que la primera cadena del resultado es la misma
+     * que entrega identificarCadena cuando esta identifica todas las etapas.
+     *
+     * @param leer Funcion que copia una ventana de I_D y de I_M (de memoria o del archivo).
+     * @param ctx Contexto con M y los datos de enmascaramiento ya cargados (o precargandose).
+     * @param pool Pool de hilos en el que se evaluan las ramas.
+     * @param buffers Pool del que se toman los arreglos para las ventanas.
+     * @param estadisticas Recibe los contadores de la busqueda.
+     * @param operaciones Cache de operaciones compartida con identificarCadena, o nullptr.
+     *
+     * @return Las cadenas que explican todas las etapas, cada una con el formato del resultado de
+     *         identificarCadena, sin dos que transformen igual la imagen. Vacio si ninguna lo hace o si el
+     *         archivo de alguna etapa no pudo cargarse (ver contexto::esperarEtapas).
+     */
+
+    TRAZA_ALCANCE("buscarCadenas");
+    estadisticas = estadisticasBusqueda();
+    vector<rama> ramas(1);
+    int n = ctx.cantidadEtapas() - 1;
+
+    for (int i = n; i >= 0 && !ramas.empty(); i--)
+    {
+        if (!ctx.esperarEtapa(i))
+        {
+            return vector<vector<int>>();
+        }
+
+        // La ventana se lee una sola vez; cada rama la transforma con su propia cadena
+        const mascaraEtapa &datos = ctx.obtenerEtapa(i);
+        size_t bytesVentana = (size_t)datos.n_pixels * 3;
+        unsigned char *ventana = buffers.obtener(bytesVentana);
+        unsigned char *ventanaIM = buffers.obtener(bytesVentana);
+        leer(datos.seed, bytesVentana, ventana, ventanaIM);
+
+        vector<mascaraCandidatos> consistentes(ramas.size(), 0);
+        grupoTareas grupo;
+        for (size_t r = 0; r < ramas.size(); r++)
+        {
+            pool.ejecutar(grupo, [&, r]() {
+                unsigned char *transformada = buffers.obtener(bytesVentana);
+                ramas[r].compilada.aplicar(transformada, ventana, ventanaIM, bytesVentana);
+                identificarVentanaCache(transformada, ventanaIM, ctx, i, consistentes[r], operaciones);
+                buffers.devolver(transformada);
+            });
+        }
+        pool.esperar(grupo);
+        buffers.devolver(ventana);
+        buffers.devolver(ventanaIM);
+        estadisticas.ramas += (long long)ramas.size();
+
+        // Cada candidato consistente abre una rama, en el orden de las ramas y de los candidatos
+        vector<rama> hijas;
+        for (size_t r = 0; r < ramas.size(); r++)
+        {
+            if (consistentes[r] == 0)
+            {
+                estadisticas.podadas++;
+            }
+            for (int c = 0; c < cantidadCandidatos(); c++)
+            {
+                if (consistentes[r] & (1ULL << c))
+                {
+                    rama hija;
+                    hija.ganadores = ramas[r].ganadores;
+                    hija.ganadores.push_back(c);
+                    hijas.push_back(hija);
+                }
+            }
+        }
+
+        // Las huellas se calculan en paralelo y las ramas equivalentes se descartan en orden
+        vector<unsigned long long> huellas(hijas.size());
+        for (size_t h = 0; h < hijas.size(); h++)
+        {
+            pool.ejecutar(grupo, [&, h]() {
+                vector<candidato> cadena;
+                for (int c : hijas[h].ganadores)
+                {
+                    cadena.push_back(obtenerCandidato(c));
+                }
+                hijas[h].compilada.compilar(cadena);
+                huellas[h] = huellaFuncion(hijas[h].compilada, buffers);
+            });
+        }
+        pool.esperar(grupo);
+
+        unordered_set<unsigned long long> vistas;
+        ramas.clear();
+        for (size_t h = 0; h < hijas.size(); h++)
+        {
+            if (!vistas.insert(huellas[h]).second)
+            {
+                estadisticas.equivalentes++;
+            }
+            else if (ramas.size() == (size_t)MAX_RAMAS_BUSQUEDA)
+            {
+                estadisticas.truncada = true;
+            }
+            else
+            {
+                ramas.push_back(hijas[h]);
+            }
+        }
+        if (ramas.empty())
+        {
+            estadisticas.etapaFallida = n - i + 1;
+        }
+    }
+
+    vector<vector<int>> soluciones;
+    for (const rama &r : ramas)
+    {
+        soluciones.push_back(r.ganadores);
+    }
+    return soluciones;
+}
+
+void reportarBusqueda(const vector<vector<int>> &soluciones, const estadisticasBusqueda &estadisticas, const vector<QString> &archivos, ostream &salida)
+{
+    /*
+     * @brief Imprime en 'salida' el resultado de buscarCadenas.
+     *
+     * La primera cadena se reporta como la de identificarCadena (ver reportarCadena); si hay mas, se
+     * listan despues, cada una con el archivo en que se exporto su imagen ('archivos', que puede tener
+     * menos elementos que 'soluciones'; las cadenas que dan la misma imagen comparten archivo, y un nombre
+     * vacio indica que la imagen no pudo exportarse).
+     */
+
+    if (soluciones.empty())
+    {
+        salida << "Ninguna cadena de transformaciones explica todas las etapas";
+        if (estadisticas.etapaFallida > 0)
+        {
+            salida << " (ninguna rama explica la transformacion " << estadisticas.etapaFallida << ")";
+        }
+        salida << endl;
+        return;
+    }
+
+    reportarCadena(soluciones[0], salida);
+    salida << "Busqueda: " << estadisticas.ramas << " ramas evaluadas, " << estadisticas.equivalentes << " equivalentes unidas, " << estadisticas.podadas
+           << " podadas" << endl;
+    if (estadisticas.truncada)
+    {
+        salida << "La busqueda se limito a " << MAX_RAMAS_BUSQUEDA << " ramas por etapa: puede haber mas cadenas validas" << endl;
+    }
+    if (soluciones.size() == 1)
+    {
+        salida << "La cadena es la unica que explica todas las etapas" << endl;
+        return;
+    }
+
+    salida << "Hay " << soluciones.size() << " cadenas distintas que explican todas las etapas:" << endl;
+    for (size_t k = 0; k < soluciones.size(); k++)
+    {
+        salida << "    " << k + 1 << ": " << describirCadena(soluciones[k]);
+        if (k < archivos.size())
+        {
+            salida << " (" << (archivos[k].isEmpty() ? string("no se pudo exportar") : archivos[k].toStdString()) << ")";
+        }
+        salida << endl;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef BUSQUEDA_H
+#define BUSQUEDA_H
+
+#include "reconstruccion.h"
+
+#include <ostream>
+#include <vector>
+
+class cacheOperaciones;
+class contexto;
+class poolBuffers;
+class poolHilos;
+
+// Cantidad maxima de ramas (estados distintos) que la busqueda mantiene por etapa
+const int MAX_RAMAS_BUSQUEDA = 4096;
+
+// Contadores de una busqueda (ver buscarCadenas)
+struct estadisticasBusqueda
+{
+    long long ramas = 0;        // Estados evaluados, sumando todas las etapas
+    long long equivalentes = 0; // Ramas descartadas por llegar a un estado ya visto en la misma etapa
+    long long podadas = 0;      // Ramas sin ningun candidato consistente en la etapa siguiente
+    int etapaFallida = -1;      // Transformacion (1..n) en la que murieron todas las ramas, o -1
+    bool truncada = false;      // Alguna etapa supero MAX_RAMAS_BUSQUEDA
+};
+
+std::vector<std::vector<int>> buscarCadenas(const lectorVentana &leer, const contexto &ctx, poolHilos &pool, poolBuffers &buffers,
+                                            estadisticasBusqueda &estadisticas, cacheOperaciones *operaciones = nullptr);
+void reportarBusqueda(const std::vector<std::vector<int>> &soluciones, const estadisticasBusqueda &estadisticas, const std::vector<QString> &archivos,
+                      std::ostream &salida);
+
+#endif // BUSQUEDA_H
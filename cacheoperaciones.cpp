@@ -0,0 +1,232 @@
+#include "cacheoperaciones.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace
+{
+const unsigned long long PRIMO_HUELLA = 0x9E3779B97F4A7C15ULL;
+
+inline unsigned long long mezclar(unsigned long long h, unsigned long long valor)
+{
+    h ^= valor;
+    h *= PRIMO_HUELLA;
+    return h ^ (h >> 29);
+}
+
+// Cada candidato consistente se guarda como 'operacion:bits', separados por comas; "-" si no hay ninguno
+string escribirConsistentes(mascaraCandidatos consistentes)
+{
+    string texto;
+    for (int c = 0; c < cantidadCandidatos(); c++)
+    {
+        if (consistentes & (1ULL << c))
+        {
+            const candidato &actual = obtenerCandidato(c);
+            texto += (texto.empty() ? "" : ",") + string(obtenerOperacion(actual.operacion).clave) + ":" + to_string(actual.bits);
+        }
+    }
+    return texto.empty() ? "-" : texto;
+}
+
+// Lee la lista de escribirConsistentes. Retorna false si algun candidato no esta en el registro actual
+bool leerConsistentes(const char *texto, mascaraCandidatos &consistentes)
+{
+    consistentes = 0;
+    if (strcmp(texto, "-") == 0)
+    {
+        return true;
+    }
+    const char *p = texto;
+    while (*p != '\0')
+    {
+        const char *finToken = strchr(p, ',');
+        string token = finToken != nullptr ? string(p, finToken) : string(p);
+        size_t separador = token.find(':');
+        if (separador == string::npos)
+        {
+            return false;
+        }
+        int c = buscarCandidato(buscarOperacion(token.substr(0, separador).c_str()), (unsigned)atoi(token.c_str() + separador + 1));
+        if (c < 0)
+        {
+            return false;
+        }
+        consistentes |= 1ULL << c;
+        p = finToken != nullptr ? finToken + 1 : p + token.size();
+    }
+    return true;
+}
+}
+
+unsigned long long huellaBytes(const void *datos, size_t bytes, unsigned long long semilla)
+{
+    /*
+     * @brief Calcula la huella de 'bytes' bytes, palabra de 8 bytes por palabra.
+     */
+
+    const unsigned char *p = (const unsigned char *)datos;
+    unsigned long long h = semilla;
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+        unsigned long long palabra;
+        memcpy(&palabra, p + i, 8);
+        h = mezclar(h, palabra);
+    }
+    for (; i < bytes; i++)
+    {
+        h = mezclar(h, p[i]);
+    }
+    return h;
+}
+
+unsigned long long combinarHuellas(unsigned long long a, unsigned long long b)
+{
+    return mezclar(mezclar(PRIMO_HUELLA, a), b);
+}
+
+cacheOperaciones::cacheOperaciones()
+    : archivo(nullptr), aciertos(0), nuevas(0)
+{
+}
+
+cacheOperaciones::~cacheOperaciones()
+{
+    cerrar();
+}
+
+bool cacheOperaciones::abrir(const QString &ruta)
+{
+    /*
+     * @brief Carga las entradas de 'ruta' (si existe) y lo deja abierto para agregar las nuevas.
+     *
+     * Cada linea del archivo es 'clave operacion bits consistentes', con la clave en hexadecimal, la
+     * operacion por su clave del registro (ver buscarOperacion) y los consistentes como una lista de
+     * 'operacion:bits' separados por comas. Como ninguna parte de la linea depende de la posicion de los
+     * candidatos en el registro, la cache sigue siendo valida aunque ese orden cambie. Las lineas que no
+     * pueden leerse (por ejemplo, la ultima de una ejecucion interrumpida, o una con un candidato que ya
+     * no existe) se ignoran.
+     *
+     * @param ruta Archivo de la cache; se crea si no existe.
+     *
+     * @return true si el archivo pudo abrirse para escritura; false en caso contrario.
+     */
+
+    cerrar();
+    string nombre = ruta.toStdString();
+    FILE *existente = fopen(nombre.c_str(), "r");
+    bool vacio = true;
+    bool terminado = true; // false si la ultima linea quedo sin su salto de linea
+    if (existente != nullptr)
+    {
+        char linea[1024];
+        while (fgets(linea, sizeof(linea), existente) != nullptr)
+        {
+            vacio = false;
+            terminado = strchr(linea, '\n') != nullptr;
+            unsigned long long clave = 0;
+            char operacion[64];
+            unsigned bits = 0;
+            char textoConsistentes[sizeof(linea)];
+            mascaraCandidatos consistentes = 0;
+            if (linea[0] == '#' || sscanf(linea, "%llx %63s %u %1023s", &clave, operacion, &bits, textoConsistentes) != 4
+                || !leerConsistentes(textoConsistentes, consistentes))
+            {
+                continue;
+            }
+            int c = buscarCandidato(buscarOperacion(operacion), bits);
+            if (c >= 0)
+            {
+                entradas[clave] = {c, consistentes};
+            }
+        }
+        fclose(existente);
+    }
+
+    archivo = fopen(nombre.c_str(), "a");
+    if (archivo == nullptr)
+    {
+        return false;
+    }
+    if (vacio)
+    {
+        fprintf(archivo, "# cache de operaciones: clave operacion bits consistentes (operacion:bits,...)\n");
+    }
+    else if (!terminado)
+    {
+        // La linea incompleta se cierra para que la siguiente entrada no quede pegada a ella
+        fputc('\n', archivo);
+    }
+    fflush(archivo);
+    return true;
+}
+
+void cacheOperaciones::cerrar()
+{
+    if (archivo != nullptr)
+    {
+        fclose(archivo);
+        archivo = nullptr;
+    }
+    entradas.clear();
+}
+
+bool cacheOperaciones::buscar(unsigned long long clave, int &indice, mascaraCandidatos &consistentes)
+{
+    /*
+     * @brief Busca la operacion de la etapa con 'clave'.
+     *
+     * @return true si la etapa ya estaba resuelta; en ese caso 'indice' (ver obtenerCandidato) y 'consistentes' reciben el resultado.
+     */
+
+    lock_guard<mutex> bloqueo(candado);
+    map<unsigned long long, entrada>::const_iterator e = entradas.find(clave);
+    if (e == entradas.end())
+    {
+        return false;
+    }
+    indice = e->second.candidato;
+    consistentes = e->second.consistentes;
+    aciertos++;
+    return true;
+}
+
+void cacheOperaciones::guardar(unsigned long long clave, int indice, mascaraCandidatos consistentes)
+{
+    /*
+     * @brief Guarda (en memoria y al final del archivo) la operacion de una etapa resuelta.
+     *
+     * La linea se escribe y se vacia al disco de inmediato, para que sobreviva a una interrupcion posterior.
+     */
+
+    lock_guard<mutex> bloqueo(candado);
+    if (entradas.count(clave) != 0)
+    {
+        return;
+    }
+    entradas[clave] = {indice, consistentes};
+    nuevas++;
+    if (archivo != nullptr)
+    {
+        const candidato &c = obtenerCandidato(indice);
+        fprintf(archivo, "%016llx %s %u %s\n", clave, obtenerOperacion(c.operacion).clave, (unsigned)c.bits, escribirConsistentes(consistentes).c_str());
+        fflush(archivo);
+    }
+}
+
+size_t cacheOperaciones::cantidadAciertos() const
+{
+    lock_guard<mutex> bloqueo(candado);
+    return aciertos;
+}
+
+size_t cacheOperaciones::cantidadNuevas() const
+{
+    lock_guard<mutex> bloqueo(candado);
+    return nuevas;
+}
@@ -0,0 +1,55 @@
+#ifndef CACHEOPERACIONES_H
+#define CACHEOPERACIONES_H
+
+#include "identificacion.h"
+#include "operaciones.h"
+
+#include <QString>
+
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+// Huella (hash de 64 bits, no criptografico) del contenido de un arreglo. Procesar un arreglo por tramos
+// cuyo tamaño es multiplo de 8, encadenando el resultado como 'semilla', da la misma huella que procesarlo entero.
+unsigned long long huellaBytes(const void *datos, size_t bytes, unsigned long long semilla = 0);
+unsigned long long combinarHuellas(unsigned long long a, unsigned long long b);
+
+// Cache persistente de las operaciones identificadas. Cada etapa resuelta se guarda con una clave que
+// resume todo lo que determina su resultado (ver claveEtapa en reconstruccion.cpp). Las entradas se
+// agregan al archivo apenas se resuelve cada etapa, de modo que una ejecucion interrumpida se retoma
+// desde la ultima etapa guardada.
+class cacheOperaciones
+{
+public:
+    cacheOperaciones();
+    ~cacheOperaciones();
+
+    bool abrir(const QString &archivo);
+    void cerrar();
+
+    bool buscar(unsigned long long clave, int &indice, mascaraCandidatos &consistentes);
+    void guardar(unsigned long long clave, int indice, mascaraCandidatos consistentes);
+
+    size_t cantidadAciertos() const;
+    size_t cantidadNuevas() const;
+
+private:
+    struct entrada
+    {
+        int candidato;
+        mascaraCandidatos consistentes;
+    };
+
+    cacheOperaciones(const cacheOperaciones &) = delete;
+    cacheOperaciones &operator=(const cacheOperaciones &) = delete;
+
+    std::map<unsigned long long, entrada> entradas;
+    mutable std::mutex candado;
+    FILE *archivo;
+    size_t aciertos;
+    size_t nuevas;
+};
+
+#endif // CACHEOPERACIONES_H
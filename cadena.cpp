@@ -0,0 +1,155 @@
+#include "cadena.h"
+#include "kernels.h"
+#include "pool.h"
+#include "traza.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+// Tamaño del bloque que recorre toda la cadena antes de pasar al siguiente: cabe en la cache L1, de modo
+// que solo el primer paso lee de memoria y solo el ultimo escribe en ella.
+const size_t BYTES_BLOQUE = 16 * 1024;
+}
+
+cadenaCompilada::cadenaCompilada()
+    : posicional(false), directa(false)
+{
+}
+
+void cadenaCompilada::compilar(const vector<candidato> &cadena, bool transformacionDirecta)
+{
+    /*
+     * @brief Compila una cadena de operaciones, en el orden en que se aplican.
+     *
+     * Esta función recorre la cadena y compone cada racha de operaciones no posicionales en una sola
+     * tabla (tabla[x] = f_k(...f_1(x))), usando las versiones de un byte del registro. Cada operacion
+     * posicional se guarda como un paso aparte, que se aplica con su kernel.
+     *
+     * @param cadena Operaciones a aplicar, la primera es la que se aplica primero.
+     * @param transformacionDirecta false para aplicar las inversas de las operaciones (la reconstruccion);
+     *                              true para aplicar las transformaciones originales (la codificacion de un caso).
+     */
+
+    pasos.clear();
+    posicional = false;
+    directa = transformacionDirecta;
+    for (const candidato &c : cadena)
+    {
+        const descriptorOperacion &d = obtenerOperacion(c.operacion);
+        if (d.posicional)
+        {
+            paso p;
+            p.esTabla = false;
+            p.operacion = c;
+            pasos.push_back(p);
+            posicional = true;
+            continue;
+        }
+
+        // Si el paso anterior no es una tabla se empieza una nueva con la identidad
+        if (pasos.empty() || !pasos.back().esTabla)
+        {
+            paso p;
+            p.esTabla = true;
+            for (int x = 0; x < 256; x++)
+            {
+                p.tabla[x] = (unsigned char)x;
+            }
+            pasos.push_back(p);
+        }
+        unsigned char *tabla = pasos.back().tabla;
+        funcionByte f = directa ? d.byteDirecta[c.bits] : d.byteInversa[c.bits];
+        for (int x = 0; x < 256; x++)
+        {
+            tabla[x] = f(tabla[x], 0);
+        }
+    }
+}
+
+void cadenaCompilada::aplicar(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes) const
+{
+    /*
+     * @brief Aplica la cadena compilada en una sola pasada por bloques.
+     *
+     * Cada bloque de BYTES_BLOQUE bytes pasa por todos los pasos antes de seguir con el siguiente: el primer
+     * paso lee de 'origen' y escribe en 'destino', y los demas trabajan sobre 'destino' en el sitio.
+     *
+     * @param destino Arreglo donde se escribe el resultado. Puede ser el mismo 'origen'.
+     * @param origen Arreglo con los valores RGB a transformar.
+     * @param IM Valores de I_M alineados con 'origen' (solo se leen si usaIM() es true).
+     * @param totalBytes Cantidad de bytes a transformar.
+     */
+
+    TRAZA_ALCANCE("aplicarCadena");
+    TRAZA_SUMAR(traza::BYTES_TRANSFORMADOS, (long long)totalBytes * pasos.size());
+    if (pasos.empty())
+    {
+        if (destino != origen)
+        {
+            memcpy(destino, origen, totalBytes);
+        }
+        return;
+    }
+
+    for (size_t inicio = 0; inicio < totalBytes; inicio += BYTES_BLOQUE)
+    {
+        size_t bytes = totalBytes - inicio < BYTES_BLOQUE ? totalBytes - inicio : BYTES_BLOQUE;
+        const unsigned char *entrada = origen + inicio;
+        unsigned char *salida = destino + inicio;
+        for (const paso &p : pasos)
+        {
+            if (p.esTabla)
+            {
+                kernels::tabla(salida, entrada, p.tabla, bytes);
+            }
+            else if (directa)
+            {
+                aplicarDirecta(p.operacion, salida, entrada, IM != nullptr ? IM + inicio : nullptr, bytes);
+            }
+            else
+            {
+                aplicarCandidato(p.operacion, salida, entrada, IM != nullptr ? IM + inicio : nullptr, bytes);
+            }
+            entrada = salida;
+        }
+    }
+}
+
+void cadenaCompilada::aplicar(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes, poolHilos &pool) const
+{
+    /*
+     * @brief Aplica la cadena compilada repartiendo la imagen entre los hilos del pool.
+     *
+     * Los parametros son los mismos de la version secuencial; cada hilo recibe un tramo contiguo.
+     */
+
+    int partes = pool.cantidadHilos() + 1;
+    size_t bytesParte = (totalBytes / partes + 63) & ~(size_t)63;
+    if (bytesParte < BYTES_BLOQUE)
+    {
+        bytesParte = BYTES_BLOQUE;
+    }
+
+    grupoTareas grupo;
+    for (size_t inicio = 0; inicio < totalBytes; inicio += bytesParte)
+    {
+        size_t cantidad = totalBytes - inicio < bytesParte ? totalBytes - inicio : bytesParte;
+        pool.ejecutar(grupo, [=]() {
+            aplicar(destino + inicio, origen + inicio, IM != nullptr ? IM + inicio : nullptr, cantidad);
+        });
+    }
+    pool.esperar(grupo);
+}
+
+bool cadenaCompilada::usaIM() const
+{
+    return posicional;
+}
+
+int cadenaCompilada::cantidadPasos() const
+{
+    return (int)pasos.size();
+}
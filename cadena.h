@@ -0,0 +1,40 @@
+#ifndef CADENA_H
+#define CADENA_H
+
+#include "operaciones.h"
+
+#include <cstddef>
+#include <vector>
+
+class poolHilos;
+
+// Cadena de operaciones, compilada para aplicarse en una sola pasada sobre la imagen (sus inversas al
+// reconstruir, o las transformaciones originales al codificar un caso).
+// Las operaciones consecutivas que no dependen de la posicion se componen en una tabla de 256 entradas;
+// las posicionales (las que leen I_M) quedan como pasos propios entre las tablas.
+class cadenaCompilada
+{
+public:
+    cadenaCompilada();
+
+    void compilar(const std::vector<candidato> &cadena, bool transformacionDirecta = false);
+    void aplicar(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes) const;
+    void aplicar(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes, poolHilos &pool) const;
+
+    bool usaIM() const;
+    int cantidadPasos() const;
+
+private:
+    struct paso
+    {
+        bool esTabla;
+        unsigned char tabla[256];
+        candidato operacion; // Solo para los pasos posicionales
+    };
+
+    std::vector<paso> pasos;
+    bool posicional;
+    bool directa; // true si se compilaron las transformaciones originales
+};
+
+#endif // CADENA_H
@@ -0,0 +1,353 @@
+#include "codecbmp.h"
+#include "traza.h"
+
+#include <QtGlobal>
+#include <climits>
+#include <cstring>
+
+#if defined(Q_OS_LINUX)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+const size_t BYTES_CABECERA_ARCHIVO = 14;
+const size_t BYTES_CABECERA_INFO = 40;
+
+// Cantidad de filas copiadas despues de la cual se descartan sus paginas del mapeo (ver descartarFilas)
+const int FILAS_TRAMO = 64;
+
+unsigned int leer32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+unsigned short int leer16(const unsigned char *p)
+{
+    return (unsigned short int)(p[0] | (p[1] << 8));
+}
+
+void escribir32(unsigned char *p, unsigned int v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+// Intercambia los canales R y B de 'pixeles' pixeles (BGR <-> RGB)
+void intercambiarCanales(unsigned char *destino, const unsigned char *origen, size_t pixeles)
+{
+    for (size_t x = 0; x < pixeles; x++)
+    {
+        destino[3 * x] = origen[3 * x + 2];
+        destino[3 * x + 1] = origen[3 * x + 1];
+        destino[3 * x + 2] = origen[3 * x];
+    }
+}
+}
+
+imagenBMP::imagenBMP() : pixeles(nullptr), width(0), height(0), bytesPorFila(0), ascendente(true)
+{
+}
+
+imagenBMP::~imagenBMP()
+{
+    cerrar();
+}
+
+bool imagenBMP::abrir(const QString &ruta)
+{
+    /*
+     * @brief Abre un archivo BMP de 24 bits y lo mapea en memoria.
+     *
+     * Esta función interpreta la cabecera del archivo (BITMAPFILEHEADER y BITMAPINFOHEADER o sus
+     * versiones extendidas), valida que la imagen sea de 24 bits sin compresion y registra el tamaño
+     * de cada fila (con su relleno) y el orden de las filas (de abajo hacia arriba o al reves).
+     *
+     * @param ruta Ruta del archivo BMP.
+     *
+     * @return true si la imagen pudo abrirse; false si el archivo no existe, esta truncado o usa un
+     *         formato no soportado (paleta, otra profundidad o compresion).
+     */
+
+    cerrar();
+    archivo.setFileName(ruta);
+    if (!archivo.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    // La cabecera se lee y se valida antes de mapear el archivo
+    qint64 tamano = archivo.size();
+    unsigned char cabecera[BYTES_CABECERA_ARCHIVO + BYTES_CABECERA_INFO];
+    if (tamano < (qint64)sizeof(cabecera) || archivo.read((char *)cabecera, sizeof(cabecera)) != (qint64)sizeof(cabecera) || cabecera[0] != 'B'
+        || cabecera[1] != 'M')
+    {
+        cerrar();
+        return false;
+    }
+
+    unsigned int inicioPixeles = leer32(cabecera + 10);
+    unsigned int tamanoInfo = leer32(cabecera + 14);
+    int w = (int)leer32(cabecera + 18);
+    int h = (int)leer32(cabecera + 22);
+    unsigned short int planos = leer16(cabecera + 26);
+    unsigned short int bitsPorPixel = leer16(cabecera + 28);
+    unsigned int compresion = leer32(cabecera + 30);
+
+    // INT_MIN no tiene valor absoluto en un int: no puede ser la altura de una imagen de arriba hacia abajo
+    if (tamanoInfo < BYTES_CABECERA_INFO || planos != 1 || bitsPorPixel != 24 || compresion != 0 || w <= 0 || h == 0 || h == INT_MIN)
+    {
+        cerrar();
+        return false;
+    }
+
+    // Altura negativa: las filas estan guardadas de arriba hacia abajo
+    ascendente = h > 0;
+    width = w;
+    height = h > 0 ? h : -h;
+    bytesPorFila = ((size_t)width * 3 + 3) & ~(size_t)3;
+
+    // Los pixeles empiezan despues de las cabeceras y todas las filas, con su relleno, estan en el archivo
+    qint64 finPixeles = (qint64)inicioPixeles + (qint64)bytesPorFila * height;
+    if ((qint64)inicioPixeles < (qint64)BYTES_CABECERA_ARCHIVO + tamanoInfo || finPixeles > tamano)
+    {
+        cerrar();
+        return false;
+    }
+
+    const unsigned char *mapa = archivo.map(0, tamano);
+    if (mapa == nullptr)
+    {
+        cerrar();
+        return false;
+    }
+    pixeles = mapa + inicioPixeles;
+    return true;
+}
+
+void imagenBMP::cerrar()
+{
+    archivo.close();
+    pixeles = nullptr;
+    width = 0;
+    height = 0;
+    bytesPorFila = 0;
+}
+
+int imagenBMP::ancho() const
+{
+    return width;
+}
+
+int imagenBMP::alto() const
+{
+    return height;
+}
+
+size_t imagenBMP::totalBytes() const
+{
+    return (size_t)width * height * 3;
+}
+
+const unsigned char *imagenBMP::filaBGR(int y) const
+{
+    /*
+     * @brief Retorna la fila 'y' (contando desde arriba) directamente desde el mapeo, sin copiarla.
+     *
+     * @note Los bytes estan en el orden del archivo (B, G, R) y son validos mientras la imagen este abierta.
+     */
+
+    int filaArchivo = ascendente ? height - 1 - y : y;
+    return pixeles + (size_t)filaArchivo * bytesPorFila;
+}
+
+bool imagenBMP::copiarRGB(unsigned char *destino) const
+{
+    /*
+     * @brief Copia la imagen completa a 'destino' en orden R, G, B, sin relleno y de arriba hacia abajo.
+     *
+     * @param destino Arreglo del usuario de al menos totalBytes() bytes.
+     *
+     * @return false si no hay una imagen abierta.
+     */
+
+    if (pixeles == nullptr)
+    {
+        return false;
+    }
+    for (int y = 0; y < height; y++)
+    {
+        intercambiarCanales(destino + (size_t)y * width * 3, filaBGR(y), width);
+        if ((y + 1) % FILAS_TRAMO == 0 || y + 1 == height)
+        {
+            descartarFilas(y - y % FILAS_TRAMO, y + 1);
+        }
+    }
+    return true;
+}
+
+void imagenBMP::copiarRangoRGB(size_t inicio, size_t bytes, unsigned char *destino) const
+{
+    /*
+     * @brief Copia a 'destino' los bytes [inicio, inicio + bytes) de la imagen en orden R, G, B.
+     *
+     * Las posiciones son las mismas del arreglo que retorna bmp::loadPixels, por lo que esta función
+     * permite leer solo una ventana de la imagen (por ejemplo, la del enmascaramiento) sin cargarla entera.
+     */
+
+    TRAZA_SUMAR(traza::BYTES_LEIDOS, bytes);
+    size_t bytesFila = (size_t)width * 3;
+    size_t fin = inicio + bytes;
+    size_t posicion = inicio;
+    int pendiente = inicio / bytesFila; // Primera fila copiada que todavia no se descarto
+    while (posicion < fin)
+    {
+        int y = posicion / bytesFila;
+        size_t enFila = posicion % bytesFila;
+        size_t hasta = bytesFila < fin - posicion + enFila ? bytesFila : fin - posicion + enFila;
+        const unsigned char *fila = filaBGR(y);
+        for (size_t k = enFila; k < hasta; k++)
+        {
+            // El canal k%3 del pixel k/3 esta en la posicion 2 - k%3 del pixel en el archivo
+            *destino++ = fila[k - k % 3 + 2 - k % 3];
+        }
+        posicion += hasta - enFila;
+
+        // Las filas ya copiadas se descartan por tramos, sin esperar al final del rango
+        if ((y + 1) % FILAS_TRAMO == 0 || posicion >= fin)
+        {
+            descartarFilas(pendiente, y + 1);
+            pendiente = y + 1;
+        }
+    }
+}
+
+void imagenBMP::descartarFilas(int desde, int hasta) const
+{
+    /*
+     * @brief Indica al sistema que las paginas del mapeo con las filas [desde, hasta) ya no se necesitan.
+     *
+     * Las paginas leidas de un mapeo cuentan como memoria residente del proceso hasta que el sistema las
+     * descarta; como cada fila se copia una sola vez, se descartan apenas se copian para que el pico de
+     * memoria no incluya el archivo completo. Si vuelven a leerse, el sistema las carga otra vez del archivo.
+     * Solo se descartan las paginas completas del rango (en Linux; en otros sistemas no hace nada).
+     */
+
+#if defined(Q_OS_LINUX)
+    int primera = ascendente ? height - hasta : desde;
+    int ultima = ascendente ? height - desde : hasta;
+    size_t pagina = (size_t)sysconf(_SC_PAGESIZE);
+    size_t inicio = ((size_t)(pixeles + (size_t)primera * bytesPorFila) + pagina - 1) & ~(pagina - 1);
+    size_t fin = (size_t)(pixeles + (size_t)ultima * bytesPorFila) & ~(pagina - 1);
+    if (fin > inicio)
+    {
+        madvise((void *)inicio, fin - inicio, MADV_DONTNEED);
+    }
+#else
+    Q_UNUSED(desde);
+    Q_UNUSED(hasta);
+#endif
+}
+
+escritorBMP::escritorBMP() : fila(nullptr), width(0), height(0), bytesPorFila(0), correcto(false)
+{
+}
+
+escritorBMP::~escritorBMP()
+{
+    cerrar();
+}
+
+bool escritorBMP::abrir(const QString &ruta, int ancho, int alto)
+{
+    /*
+     * @brief Crea un archivo BMP de 24 bits de 'ancho' x 'alto' y escribe su cabecera.
+     *
+     * El archivo se reserva completo desde el principio, de modo que las filas pueden escribirse en
+     * cualquier orden con escribirFila, cada una directamente en su posicion (de abajo hacia arriba).
+     *
+     * @return true si el archivo pudo crearse.
+     */
+
+    cerrar();
+    width = ancho;
+    height = alto;
+    bytesPorFila = ((size_t)width * 3 + 3) & ~(size_t)3;
+    size_t bytesPixeles = bytesPorFila * height;
+
+    unsigned char cabecera[BYTES_CABECERA_ARCHIVO + BYTES_CABECERA_INFO];
+    memset(cabecera, 0, sizeof(cabecera));
+    cabecera[0] = 'B';
+    cabecera[1] = 'M';
+    escribir32(cabecera + 2, (unsigned int)(sizeof(cabecera) + bytesPixeles));
+    escribir32(cabecera + 10, sizeof(cabecera));
+    escribir32(cabecera + 14, BYTES_CABECERA_INFO);
+    escribir32(cabecera + 18, (unsigned int)width);
+    escribir32(cabecera + 22, (unsigned int)height);
+    cabecera[26] = 1;  // Planos
+    cabecera[28] = 24; // Bits por pixel
+    escribir32(cabecera + 34, (unsigned int)bytesPixeles);
+
+    archivo.setFileName(ruta);
+    correcto = archivo.open(QIODevice::WriteOnly)
+               && archivo.write((const char *)cabecera, sizeof(cabecera)) == (qint64)sizeof(cabecera)
+               && archivo.resize(sizeof(cabecera) + bytesPixeles);
+
+    fila = new unsigned char[bytesPorFila];
+    memset(fila, 0, bytesPorFila);
+    return correcto;
+}
+
+bool escritorBMP::escribirFila(int y, const unsigned char *filaRGB)
+{
+    /*
+     * @brief Escribe la fila 'y' (contando desde arriba) a partir de sus pixeles R, G, B sin relleno.
+     */
+
+    if (!correcto || y < 0 || y >= height)
+    {
+        return false;
+    }
+    intercambiarCanales(fila, filaRGB, width);
+    qint64 posicion = (qint64)(BYTES_CABECERA_ARCHIVO + BYTES_CABECERA_INFO) + (qint64)(height - 1 - y) * bytesPorFila;
+    correcto = archivo.seek(posicion) && archivo.write((const char *)fila, bytesPorFila) == (qint64)bytesPorFila;
+    return correcto;
+}
+
+bool escritorBMP::escribirFilas(int y, int cantidad, const unsigned char *filasRGB)
+{
+    /*
+     * @brief Escribe 'cantidad' filas consecutivas desde la fila 'y', tomadas de un arreglo R, G, B sin relleno.
+     */
+
+    for (int k = 0; k < cantidad && correcto; k++)
+    {
+        escribirFila(y + k, filasRGB + (size_t)k * width * 3);
+    }
+    return correcto;
+}
+
+bool escritorBMP::cerrar()
+{
+    /*
+     * @brief Cierra el archivo.
+     *
+     * @return true si todas las escrituras fueron exitosas.
+     */
+
+    bool resultado = correcto;
+    if (archivo.isOpen())
+    {
+        resultado = archivo.flush() && resultado;
+        archivo.close();
+    }
+    delete[] fila;
+    fila = nullptr;
+    correcto = false;
+    return resultado;
+}
@@ -0,0 +1,67 @@
+#ifndef CODECBMP_H
+#define CODECBMP_H
+
+#include <QFile>
+#include <QString>
+#include <cstddef>
+
+// Lector de archivos BMP de 24 bits sin compresion. El archivo se mapea en memoria y las filas se
+// leen directamente del mapeo (en el orden B, G, R del archivo) o se copian una sola vez, ya en
+// orden R, G, B y sin relleno, a un arreglo del usuario.
+class imagenBMP
+{
+public:
+    imagenBMP();
+    ~imagenBMP();
+
+    bool abrir(const QString &ruta);
+    void cerrar();
+
+    int ancho() const;
+    int alto() const;
+    size_t totalBytes() const;
+
+    const unsigned char *filaBGR(int y) const;
+    bool copiarRGB(unsigned char *destino) const;
+    void copiarRangoRGB(size_t inicio, size_t bytes, unsigned char *destino) const;
+
+private:
+    imagenBMP(const imagenBMP &) = delete;
+    imagenBMP &operator=(const imagenBMP &) = delete;
+
+    void descartarFilas(int desde, int hasta) const;
+
+    QFile archivo;
+    const unsigned char *pixeles; // Inicio de los datos de pixeles dentro del mapeo
+    int width;
+    int height;
+    size_t bytesPorFila;          // Incluye el relleno hasta multiplo de 4
+    bool ascendente;              // true si las filas estan guardadas de abajo hacia arriba
+};
+
+// Escritor de archivos BMP de 24 bits que recibe la imagen fila por fila (en orden R, G, B y sin
+// relleno), sin necesitar la imagen completa en memoria.
+class escritorBMP
+{
+public:
+    escritorBMP();
+    ~escritorBMP();
+
+    bool abrir(const QString &ruta, int ancho, int alto);
+    bool escribirFila(int y, const unsigned char *filaRGB);
+    bool escribirFilas(int y, int cantidad, const unsigned char *filasRGB);
+    bool cerrar();
+
+private:
+    escritorBMP(const escritorBMP &) = delete;
+    escritorBMP &operator=(const escritorBMP &) = delete;
+
+    QFile archivo;
+    unsigned char *fila;
+    int width;
+    int height;
+    size_t bytesPorFila;
+    bool correcto;
+};
+
+#endif // CODECBMP_H
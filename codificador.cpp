@@ -0,0 +1,291 @@
+#include "codificador.h"
+#include "bmp.h"
+#include "cadena.h"
+#include "generador.h"
+#include "pool.h"
+
+#include <QDir>
+#include <QFile>
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+namespace
+{
+// Tamaño del buffer con el que se escribe cada archivo de enmascaramiento
+const size_t BYTES_ESCRITURA = 256 * 1024;
+
+// Escribe 'valor' en 'p' y retorna el puntero al byte siguiente (hay lugar: el llamador vacia el buffer antes)
+inline char *escribirEntero(char *p, int valor)
+{
+    return to_chars(p, p + 16, valor).ptr;
+}
+}
+
+bool interpretarCadena(const string &texto, vector<candidato> &cadena)
+{
+    /*
+     * @brief Interpreta una cadena de operaciones escrita como 'clave[:bits],clave[:bits],...'.
+     *
+     * Cada clave nombra la transformacion original que se aplica (ver buscarOperacionDirecta), por ejemplo
+     * "xor,rotIzq:3,despDer:2": despDer:2 desplaza cada byte 2 bits a la derecha. Las operaciones que usan
+     * bits deben indicarlos; las demas no.
+     *
+     * cadena.txt, en cambio, tiene el texto con que la reconstruccion reporta cada etapa, que para los
+     * desplazamientos nombra la operacion que los deshace: despDer:2 se reporta como "un desplazamiento a
+     * la izquierda de 2 bits".
+     *
+     * @param texto Cadena a interpretar, en el orden en que se aplican las transformaciones originales.
+     * @param cadena Vector al que se agregan los candidatos.
+     *
+     * @return true si todas las operaciones existen y sus bits son validos; false en caso contrario.
+     */
+
+    stringstream flujo(texto);
+    string elemento;
+    while (getline(flujo, elemento, ','))
+    {
+        size_t separador = elemento.find(':');
+        string clave = elemento.substr(0, separador);
+        int operacion = buscarOperacionDirecta(clave.c_str());
+        unsigned bits = 0;
+        if (separador != string::npos)
+        {
+            const char *inicio = elemento.c_str() + separador + 1;
+            const char *fin = elemento.c_str() + elemento.size();
+            if (from_chars(inicio, fin, bits).ptr != fin || inicio == fin)
+            {
+                return false;
+            }
+        }
+        if (operacion < 0 || obtenerOperacion(operacion).usaBits != (separador != string::npos))
+        {
+            return false;
+        }
+        int c = buscarCandidato(operacion, bits);
+        if (c < 0)
+        {
+            return false;
+        }
+        cadena.push_back(obtenerCandidato(c));
+    }
+    return !cadena.empty();
+}
+
+bool escribirEnmascaramiento(const QString &nombre, const unsigned char *ventana, const unsigned char *M, int seed, int n_pixels)
+{
+    /*
+     * @brief Escribe un archivo M<i>.txt: la semilla y, por cada pixel de la ventana, la suma de 'ventana' y de M.
+     *
+     * El texto se arma con to_chars en un buffer de BYTES_ESCRITURA bytes, que se escribe al archivo cada
+     * vez que se llena, sin pasar por flujos ni por cadenas intermedias.
+     *
+     * @param nombre Ruta del archivo.
+     * @param ventana Los n_pixels*3 bytes del estado de la imagen desde 'seed'.
+     * @param M Los primeros n_pixels*3 bytes de M.
+     * @param seed Posicion de la ventana, que se escribe en la primera linea.
+     * @param n_pixels Cantidad de pixeles enmascarados.
+     *
+     * @return true si el archivo se escribio completo.
+     */
+
+    QFile archivo(nombre);
+    if (!archivo.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    char *buffer = new char[BYTES_ESCRITURA];
+    char *p = escribirEntero(buffer, seed);
+    *p++ = '\n';
+    bool correcto = true;
+    for (int k = 0; k < n_pixels * 3 && correcto; k += 3)
+    {
+        // Una linea ocupa a lo sumo 12 bytes ("510 510 510\n")
+        if (p + 12 > buffer + BYTES_ESCRITURA)
+        {
+            correcto = archivo.write(buffer, p - buffer) == p - buffer;
+            p = buffer;
+        }
+        p = escribirEntero(p, ventana[k] + M[k]);
+        *p++ = ' ';
+        p = escribirEntero(p, ventana[k + 1] + M[k + 1]);
+        *p++ = ' ';
+        p = escribirEntero(p, ventana[k + 2] + M[k + 2]);
+        *p++ = '\n';
+    }
+    correcto = correcto && archivo.write(buffer, p - buffer) == p - buffer;
+    delete[] buffer;
+    return correcto;
+}
+
+bool codificarCaso(const QString &rutaDirectorio, const unsigned char *original, const unsigned char *IM, const unsigned char *M, int ancho, int alto,
+                   const vector<candidato> &cadena, const vector<int> &seeds, int pixelesVentana, poolHilos &pool, ostream &salida)
+{
+    /*
+     * @brief Aplica una cadena de transformaciones a una imagen y escribe el caso distorsionado.
+     *
+     * Antes de cada transformacion j, el estado de la imagen se enmascara con M en la ventana que empieza
+     * en seeds[j] y se escribe en 'M<j>.txt'. Como todas las operaciones actuan byte a byte, el estado de
+     * una ventana se obtiene aplicando las transformaciones anteriores solo a esa ventana: cada etapa es
+     * una tarea independiente del pool, y la imagen completa se transforma una sola vez, con la cadena
+     * compilada (ver cadenaCompilada), repartida entre los hilos.
+     *
+     * En el directorio quedan I_D.bmp, los archivos M<j>.txt y cadena.txt con la transformacion de cada
+     * etapa, en el orden y con el texto con que la reporta la reconstruccion.
+     *
+     * @param rutaDirectorio Directorio del caso (debe existir).
+     * @param original Imagen original (ancho*alto*3 bytes, no se modifica).
+     * @param IM Mascara de XOR, del mismo tamaño.
+     * @param M Mascara de enmascaramiento; se leen sus primeros pixelesVentana*3 bytes.
+     * @param cadena Transformaciones originales, en el orden en que se aplican.
+     * @param seeds Posicion (en bytes) de la ventana de cada etapa; una por transformacion.
+     * @param pixelesVentana Pixeles enmascarados por etapa.
+     * @param pool Pool de hilos en el que se procesan las etapas y la imagen.
+     * @param salida Flujo en el que se informan los errores.
+     *
+     * @return true si se escribieron todos los archivos; false en caso contrario.
+     *
+     * @note La cadena puede tener desplazamientos, pero entonces I_D no permite recuperar la imagen original
+     *       (ver generarCaso).
+     */
+
+    const size_t totalBytes = (size_t)ancho * alto * 3;
+    const size_t bytesVentana = (size_t)pixelesVentana * 3;
+
+    // Las etapas son independientes: cada una transforma su ventana y escribe su archivo
+    atomic<bool> correcto(true);
+    grupoTareas grupo;
+    for (size_t j = 0; j < cadena.size(); j++)
+    {
+        pool.ejecutar(grupo, [&, j]() {
+            unsigned char *ventana = new unsigned char[bytesVentana];
+            cadenaCompilada anteriores;
+            anteriores.compilar(vector<candidato>(cadena.begin(), cadena.begin() + j), true);
+            anteriores.aplicar(ventana, original + seeds[j], IM + seeds[j], bytesVentana);
+
+            QString nombre = rutaDirectorio + "/M" + QString::number(j) + ".txt";
+            if (!escribirEnmascaramiento(nombre, ventana, M, seeds[j], pixelesVentana))
+            {
+                correcto = false;
+            }
+            delete[] ventana;
+        });
+    }
+
+    // Mientras tanto, la imagen completa se transforma con toda la cadena
+    unsigned char *ID = new unsigned char[totalBytes];
+    cadenaCompilada compilada;
+    compilada.compilar(cadena, true);
+    compilada.aplicar(ID, original, IM, totalBytes, pool);
+    pool.esperar(grupo);
+
+    bmp bmp;
+    bool escrito = correcto && bmp.exportImage(ID, ancho, alto, rutaDirectorio + "/I_D.bmp");
+    delete[] ID;
+
+    // La reconstruccion reporta primero la ultima transformacion aplicada
+    string texto;
+    for (size_t k = 0; k < cadena.size(); k++)
+    {
+        texto += "La transformacion " + to_string(k + 1) + " fue " + describirCandidato(cadena[cadena.size() - 1 - k]) + "\n";
+    }
+    QFile archivoCadena(rutaDirectorio + "/cadena.txt");
+    escrito = escrito && archivoCadena.open(QIODevice::WriteOnly) && archivoCadena.write(texto.data(), (qint64)texto.size()) == (qint64)texto.size();
+    if (!escrito)
+    {
+        salida << "No se pudieron escribir los archivos de " << rutaDirectorio.toStdString() << endl;
+    }
+    return escrito;
+}
+
+bool codificarImagen(const QString &imagenOriginal, const QString &rutaDirectorio, const vector<candidato> &cadena, const parametrosGenerador &p,
+                     poolHilos &pool, ostream &salida)
+{
+    /*
+     * @brief Codifica una imagen existente con una cadena dada (ver codificarCaso).
+     *
+     * Si el directorio ya tiene I_M.bmp y M.bmp se usan (deben tener el tamaño de la imagen); si no, se
+     * crean con bytes pseudoaleatorios. Las ventanas se ubican en posiciones pseudoaleatorias. Ambas cosas
+     * dependen solo de 'p.semilla'.
+     *
+     * @param imagenOriginal BMP a codificar.
+     * @param rutaDirectorio Directorio del caso; se crea si no existe.
+     * @param cadena Transformaciones originales, en el orden en que se aplican.
+     * @param p Tamaño de las ventanas (pixelesVentana) y semilla; el resto de los parametros no se usa.
+     * @param pool Pool de hilos en el que se procesan las etapas y la imagen.
+     * @param salida Flujo en el que se informan los errores.
+     *
+     * @return true si se escribieron todos los archivos; false en caso contrario.
+     */
+
+    bmp bmp;
+    int ancho = 0;
+    int alto = 0;
+    unsigned char *original = bmp.loadPixels(imagenOriginal, ancho, alto);
+    if (original == nullptr)
+    {
+        salida << "No se pudo cargar " << imagenOriginal.toStdString() << endl;
+        return false;
+    }
+    const size_t totalBytes = (size_t)ancho * alto * 3;
+    if (p.pixelesVentana <= 0 || (size_t)p.pixelesVentana * 3 > totalBytes || !QDir(".").mkpath(rutaDirectorio))
+    {
+        salida << "No se pudo crear el caso en " << rutaDirectorio.toStdString() << endl;
+        delete[] original;
+        return false;
+    }
+
+    // Se usan las mascaras del directorio, o se crean si no estan
+    mt19937 aleatorio(p.semilla);
+    unsigned char *mascaras[2] = {nullptr, nullptr};
+    const char *nombres[2] = {"/I_M.bmp", "/M.bmp"};
+    bool correcto = true;
+    for (int k = 0; k < 2 && correcto; k++)
+    {
+        int anchoMascara = 0;
+        int altoMascara = 0;
+        if (QFile::exists(rutaDirectorio + nombres[k]))
+        {
+            mascaras[k] = bmp.loadPixels(rutaDirectorio + nombres[k], anchoMascara, altoMascara);
+            correcto = mascaras[k] != nullptr && anchoMascara == ancho && altoMascara == alto;
+        }
+        else
+        {
+            mascaras[k] = new unsigned char[totalBytes];
+            for (size_t i = 0; i < totalBytes; i++)
+            {
+                mascaras[k][i] = (unsigned char)aleatorio();
+            }
+            correcto = bmp.exportImage(mascaras[k], ancho, alto, rutaDirectorio + nombres[k]);
+        }
+        if (!correcto)
+        {
+            salida << "I_M.bmp y M.bmp deben tener el tamaño de " << imagenOriginal.toStdString() << endl;
+        }
+    }
+
+    // Las semillas de los archivos M<i>.txt son int: la ultima posicion de una ventana debe caber en uno
+    vector<int> seeds;
+    const size_t maximoSeed = totalBytes - (size_t)p.pixelesVentana * 3;
+    if (correcto && maximoSeed > (size_t)INT_MAX)
+    {
+        salida << imagenOriginal.toStdString() << " es demasiado grande: las semillas de las ventanas no caben en un int" << endl;
+        correcto = false;
+    }
+    for (size_t j = 0; j < cadena.size(); j++)
+    {
+        seeds.push_back((int)(aleatorio() % (maximoSeed + 1)));
+    }
+
+    correcto = correcto && codificarCaso(rutaDirectorio, original, mascaras[0], mascaras[1], ancho, alto, cadena, seeds, p.pixelesVentana, pool, salida);
+    delete[] original;
+    delete[] mascaras[0];
+    delete[] mascaras[1];
+    return correcto;
+}
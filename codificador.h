@@ -0,0 +1,23 @@
+#ifndef CODIFICADOR_H
+#define CODIFICADOR_H
+
+#include "operaciones.h"
+
+#include <QString>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+class poolHilos;
+struct parametrosGenerador;
+
+bool interpretarCadena(const std::string &texto, std::vector<candidato> &cadena);
+bool escribirEnmascaramiento(const QString &nombre, const unsigned char *ventana, const unsigned char *M, int seed, int n_pixels);
+
+bool codificarCaso(const QString &rutaDirectorio, const unsigned char *original, const unsigned char *IM, const unsigned char *M, int ancho, int alto,
+                   const std::vector<candidato> &cadena, const std::vector<int> &seeds, int pixelesVentana, poolHilos &pool, std::ostream &salida);
+bool codificarImagen(const QString &imagenOriginal, const QString &rutaDirectorio, const std::vector<candidato> &cadena, const parametrosGenerador &p,
+                     poolHilos &pool, std::ostream &salida);
+
+#endif // CODIFICADOR_H
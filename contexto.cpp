@@ -0,0 +1,355 @@
+#include "contexto.h"
+#include "bmp.h"
+#include "codecbmp.h"
+#include "mascarabin.h"
+#include "precarga.h"
+#include "recursos.h"
+
+#include <QFile>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+// Posiciones de la ventana que se comparan antes que el resto: una operacion equivocada casi siempre
+// falla en alguna de ellas, por lo que se descarta leyendo unas pocas lineas de cache
+const int MUESTRAS_VERIFICACION = 16;
+
+// Llena 'muestra' con 'cantidad' posiciones pseudoaleatorias (xorshift) en [0, bytes)
+void generarMuestra(unsigned int *muestra, int cantidad, unsigned int bytes, unsigned int semilla)
+{
+    unsigned int estado = semilla * 2654435761u + 1u;
+    for (int k = 0; k < cantidad; k++)
+    {
+        estado ^= estado << 13;
+        estado ^= estado >> 17;
+        estado ^= estado << 5;
+        muestra[k] = estado % bytes;
+    }
+}
+}
+
+contexto::contexto()
+    : IM(nullptr), archivoM(nullptr), completaM(nullptr), width(0), height(0), width_M(0), height_M(0), etapas(nullptr), n_etapas(0), precargas(nullptr)
+{
+}
+
+contexto::~contexto()
+{
+    liberar();
+}
+
+bool contexto::cargar(const QString &rutaDirectorio, bool cargarImagenes, cacheImagenes *cache, int precarga)
+{
+    /*
+     * @brief Carga una unica vez todos los recursos compartidos por las etapas de la reconstruccion.
+     *
+     * Esta función decodifica la mascara de XOR 'I_M.bmp' y todos los archivos 'M<i>.txt' (o 'M<i>.bin',
+     * si existe la version binaria) del directorio, y los mantiene en memoria durante toda la ejecucion;
+     * de 'M.bmp' cada etapa solo lee el prefijo que cubre su ventana. De esta forma las transformaciones y
+     * las verificaciones de cada candidato reciben los datos por referencia en lugar de volver a leer y
+     * decodificar los mismos archivos una y otra vez.
+     *
+     * Con 'precarga' > 0, los archivos de enmascaramiento se leen en un hilo aparte, en el orden en que se
+     * identifican las etapas (de la ultima a la primera) y a lo sumo 'precarga' etapas por delante de la
+     * que se esta identificando, mientras este hilo decodifica I_M y el llamador trabaja en las etapas ya
+     * cargadas. Cada etapa debe esperarse con esperarEtapa antes de usarla.
+     *
+     * @param rutaDirectorio Ruta del directorio que contiene 'I_M.bmp', 'M.bmp' y los archivos 'M<i>.txt' o 'M<i>.bin'.
+     * @param cargarImagenes false para no cargar I_M (modo streaming, en el que las imagenes completas no
+     *                       caben en memoria).
+     * @param cache Cache de la que se toma I_M, compartida con otros contextos (modo por lotes); si es
+     *              nullptr, el contexto decodifica su propia copia.
+     * @param precarga Cantidad de etapas que se cargan por adelantado en otro hilo; 0 para cargarlas todas aqui.
+     *
+     * @return true si todos los archivos se cargaron y son consistentes entre si (con precarga, los errores
+     *         de los archivos de enmascaramiento los informa esperarEtapa); false en caso contrario.
+     *
+     * @note Si el contexto ya tenia recursos cargados, estos se liberan antes de cargar los nuevos.
+     */
+
+    bmp bmp;
+    imagenBMP archivoIM;
+    liberar();
+    ruta = rutaDirectorio;
+
+    // Las dimensiones de I_M se leen de la cabecera, para validar las ventanas sin esperar a decodificarla
+    // (solo si no es un BMP que pueda mapearse se decodifica antes)
+    if (archivoIM.abrir(rutaDirectorio + "/I_M.bmp"))
+    {
+        width = archivoIM.ancho();
+        height = archivoIM.alto();
+        archivoIM.cerrar();
+    }
+    else if (!cargarImagenes || !cargarIM(cache))
+    {
+        cerr << "No se pudo cargar " << (rutaDirectorio + "/I_M.bmp").toStdString() << endl;
+        return false;
+    }
+
+    // De M las etapas solo leen el prefijo del tamaño de su ventana; la imagen completa solo se decodifica
+    // si no es un BMP que pueda mapearse
+    archivoM = new imagenBMP;
+    if (archivoM->abrir(rutaDirectorio + "/M.bmp"))
+    {
+        width_M = archivoM->ancho();
+        height_M = archivoM->alto();
+    }
+    else if (!cargarImagenes || (completaM = bmp.loadPixels(rutaDirectorio + "/M.bmp", width_M, height_M)) == nullptr)
+    {
+        cerr << "No se pudo cargar " << (rutaDirectorio + "/M.bmp").toStdString() << endl;
+        return false;
+    }
+
+    // Se reserva un registro por cada archivo 'M<i>.txt' o 'M<i>.bin'
+    int n_texto = bmp.contarArchivosMascara(rutaDirectorio);
+    int n_binario = bmp.contarArchivosMascara(rutaDirectorio, "M*.bin");
+    n_etapas = n_texto > n_binario ? n_texto : n_binario;
+    etapas = new mascaraEtapa[n_etapas];
+    for (int i = 0; i < n_etapas; i++)
+    {
+        etapas[i].seed = 0;
+        etapas[i].n_pixels = 0;
+        etapas[i].datos = nullptr;
+        etapas[i].binario = nullptr;
+        etapas[i].esperado = nullptr;
+        etapas[i].muestra = nullptr;
+        etapas[i].n_muestra = 0;
+        etapas[i].cargada = false;
+    }
+
+    if (precarga > 0)
+    {
+        // Las etapas se agregan en el orden en que se identifican: la carga de la etapa i es la n-1-i
+        precargas = new precargador(precarga);
+        for (int i = n_etapas - 1; i >= 0; i--)
+        {
+            precargas->agregar([this, i]() { etapas[i].cargada = cargarEtapa(i); });
+        }
+    }
+    else
+    {
+        for (int i = 0; i < n_etapas; i++)
+        {
+            etapas[i].cargada = cargarEtapa(i);
+            if (!etapas[i].cargada)
+            {
+                return false;
+            }
+        }
+    }
+
+    // Mientras tanto se decodifica I_M (una sola vez)
+    if (cargarImagenes && IM == nullptr && !cargarIM(cache))
+    {
+        cerr << "No se pudo cargar " << (rutaDirectorio + "/I_M.bmp").toStdString() << endl;
+        return false;
+    }
+    return true;
+}
+
+bool contexto::cargarIM(cacheImagenes *cache)
+{
+    /*
+     * @brief Decodifica I_M (o la toma de 'cache', si no es nullptr).
+     */
+
+    int w = 0;
+    int h = 0;
+    if (cache != nullptr)
+    {
+        // I_M se comparte con los demas casos que usan el mismo archivo
+        compartidaIM = cache->obtener(ruta + "/I_M.bmp");
+        if (!compartidaIM)
+        {
+            return false;
+        }
+        IM = compartidaIM->pixeles;
+        w = compartidaIM->ancho;
+        h = compartidaIM->alto;
+    }
+    else
+    {
+        bmp bmp;
+        IM = bmp.loadPixels(ruta + "/I_M.bmp", w, h);
+    }
+
+    // Las dimensiones solo se escriben si no se conocian por la cabecera: la precarga puede estar leyendolas
+    if (width == 0 && height == 0)
+    {
+        width = w;
+        height = h;
+    }
+    return IM != nullptr;
+}
+
+bool contexto::cargarEtapa(int i)
+{
+    /*
+     * @brief Lee el archivo de enmascaramiento de la etapa 'i', valida que su ventana quepa en las imagenes
+     *        y calcula la ventana esperada y la muestra con la que se rechazan los candidatos.
+     *
+     * @note Puede ejecutarse en el hilo de precarga; solo escribe en etapas[i].
+     */
+
+    bmp bmp;
+    mascaraEtapa &etapa = etapas[i];
+
+    // Si existe la version binaria se usa directamente desde el mapeo del archivo, sin copiarla
+    QString name = ruta + "/M" + QString::number(i) + ".bin";
+    if (QFile::exists(name))
+    {
+        etapa.binario = new mascaraBinaria;
+        if (etapa.binario->abrir(name))
+        {
+            etapa.seed = etapa.binario->seed();
+            etapa.n_pixels = etapa.binario->n_pixels();
+            etapa.datos = etapa.binario->datos();
+        }
+    }
+    else
+    {
+        name = ruta + "/M" + QString::number(i) + ".txt";
+        etapa.datos = bmp.loadSeedMasking(name.toStdString().c_str(), etapa.seed, etapa.n_pixels);
+    }
+    if (etapa.datos == nullptr)
+    {
+        cerr << "No se pudo cargar " << name.toStdString() << endl;
+        return false;
+    }
+
+    // Todo en 64 bits: con imagenes de mas de 2 GiB el final de la ventana no cabe en un int. La ventana
+    // en si debe caber, porque las funciones de bmp la recorren con indices int
+    long long bytesEtapa = (long long)etapa.n_pixels * 3;
+    long long fin = (long long)etapa.seed + bytesEtapa;
+    if (etapa.seed < 0 || etapa.n_pixels < 0 || fin > (long long)totalBytes() || bytesEtapa > (long long)width_M * height_M * 3 || bytesEtapa > INT_MAX)
+    {
+        cerr << "El enmascaramiento de " << name.toStdString() << " excede el tamaño de las imagenes" << endl;
+        return false;
+    }
+
+    // La ventana esperada se calcula con el prefijo de M, que solo se copia mientras dura el calculo
+    size_t bytesVentana = (size_t)etapa.n_pixels * 3;
+    unsigned char *prefijo = new unsigned char[bytesVentana > 0 ? bytesVentana : 1];
+    if (completaM != nullptr)
+    {
+        memcpy(prefijo, completaM, bytesVentana);
+    }
+    else
+    {
+        archivoM->copiarRangoRGB(0, bytesVentana, prefijo);
+    }
+    etapa.esperado = bmp.calcularPreimagen(prefijo, etapa.datos, etapa.n_pixels);
+    delete[] prefijo;
+
+    etapa.n_muestra = etapa.n_pixels * 3 < MUESTRAS_VERIFICACION ? etapa.n_pixels * 3 : MUESTRAS_VERIFICACION;
+    etapa.muestra = new unsigned int[etapa.n_muestra > 0 ? etapa.n_muestra : 1];
+    generarMuestra(etapa.muestra, etapa.n_muestra, etapa.n_pixels * 3, etapa.seed ^ (unsigned int)i);
+    return true;
+}
+
+bool contexto::esperarEtapa(int i) const
+{
+    /*
+     * @brief Espera a que la etapa 'i' este cargada (si la carga el hilo de precarga).
+     *
+     * @return true si la etapa se cargo correctamente; false si su archivo no pudo cargarse o no es valido.
+     */
+
+    if (precargas != nullptr)
+    {
+        precargas->reclamar(n_etapas - 1 - i);
+    }
+    return etapas[i].cargada;
+}
+
+bool contexto::esperarEtapas() const
+{
+    /*
+     * @brief Espera a todas las etapas.
+     *
+     * @return true si todas se cargaron correctamente.
+     */
+
+    bool correctas = true;
+    for (int i = n_etapas - 1; i >= 0; i--)
+    {
+        correctas = esperarEtapa(i) && correctas;
+    }
+    return correctas;
+}
+
+void contexto::liberar()
+{
+    /*
+     * @brief Libera todos los recursos cargados por el contexto.
+     */
+
+    // Primero se detiene la precarga, que escribe en las etapas
+    delete precargas;
+    precargas = nullptr;
+
+    // La imagen compartida la libera la cache cuando ningun contexto la usa
+    if (!compartidaIM)
+    {
+        delete[] IM;
+    }
+    compartidaIM.reset();
+    delete archivoM;
+    delete[] completaM;
+    for (int i = 0; i < n_etapas; i++)
+    {
+        // Los datos de un archivo binario pertenecen a su mapeo; los del .txt se reservaron con new[]
+        if (etapas[i].binario != nullptr)
+        {
+            delete etapas[i].binario;
+        }
+        else
+        {
+            delete[] etapas[i].datos;
+        }
+        delete[] etapas[i].esperado;
+        delete[] etapas[i].muestra;
+    }
+    delete[] etapas;
+
+    IM = nullptr;
+    archivoM = nullptr;
+    completaM = nullptr;
+    etapas = nullptr;
+    n_etapas = 0;
+    width = height = width_M = height_M = 0;
+}
+
+const unsigned char *contexto::obtenerIM() const
+{
+    return IM;
+}
+
+const mascaraEtapa &contexto::obtenerEtapa(int i) const
+{
+    return etapas[i];
+}
+
+int contexto::cantidadEtapas() const
+{
+    return n_etapas;
+}
+
+int contexto::ancho() const
+{
+    return width;
+}
+
+int contexto::alto() const
+{
+    return height;
+}
+
+size_t contexto::totalBytes() const
+{
+    return (size_t)width * height * 3;
+}
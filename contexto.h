@@ -0,0 +1,66 @@
+#ifndef CONTEXTO_H
+#define CONTEXTO_H
+
+#include <QString>
+
+#include <memory>
+
+class cacheImagenes;
+class imagenBMP;
+class mascaraBinaria;
+class precargador;
+struct imagenCompartida;
+
+struct mascaraEtapa
+{
+    int seed;                        // Posicion inicial (en bytes) del enmascaramiento
+    int n_pixels;                    // Cantidad de pixeles enmascarados
+    const unsigned short int *datos; // Resultados del enmascaramiento (R, G, B, R, G, B, ...)
+    mascaraBinaria *binario;         // Archivo M<i>.bin mapeado del que provienen 'datos' (nullptr si vienen del .txt)
+    unsigned char *esperado;         // Ventana que debe producir la operacion (datos - M); nullptr si ningun byte produce 'datos'
+    unsigned int *muestra;           // Posiciones pseudoaleatorias de la ventana que se comparan antes que el resto
+    int n_muestra;
+    bool cargada;                    // false si el archivo no pudo cargarse o su ventana no cabe en las imagenes
+};
+
+class contexto
+{
+public:
+    contexto();
+    ~contexto();
+
+    bool cargar(const QString &rutaDirectorio, bool cargarImagenes = true, cacheImagenes *cache = nullptr, int precarga = 0);
+    void liberar();
+
+    bool esperarEtapa(int i) const;
+    bool esperarEtapas() const;
+
+    const unsigned char *obtenerIM() const;
+    const mascaraEtapa &obtenerEtapa(int i) const;
+    int cantidadEtapas() const;
+    int ancho() const;
+    int alto() const;
+    size_t totalBytes() const;
+
+private:
+    contexto(const contexto &) = delete;
+    contexto &operator=(const contexto &) = delete;
+
+    bool cargarIM(cacheImagenes *cache);
+    bool cargarEtapa(int i);
+
+    QString ruta;
+    const unsigned char *IM;
+    std::shared_ptr<const imagenCompartida> compartidaIM; // Si I_M viene de una cache, IM apunta a sus pixeles
+    imagenBMP *archivoM;                                  // M mapeada, de la que cada etapa copia el prefijo que necesita
+    unsigned char *completaM;                             // M decodificada, solo si no pudo mapearse
+    int width;
+    int height;
+    int width_M;
+    int height_M;
+    mascaraEtapa *etapas;
+    int n_etapas;
+    precargador *precargas; // Carga las etapas en otro hilo (nullptr si se cargaron en cargar)
+};
+
+#endif // CONTEXTO_H
@@ -0,0 +1,258 @@
+#include "generador.h"
+#include "bmp.h"
+#include "codificador.h"
+#include "operaciones.h"
+#include "reconstruccion.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <climits>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+parametrosGenerador::parametrosGenerador()
+    : ancho(640), alto(480), etapas(4), pixelesVentana(1000), semilla(1)
+{
+}
+
+namespace
+{
+// true si la transformacion del candidato 'c' es igual, para todo byte y todo byte de I_M, a la de un candidato anterior
+bool equivaleAAnterior(int c)
+{
+    const candidato &actual = obtenerCandidato(c);
+    funcionByte f = obtenerOperacion(actual.operacion).byteDirecta[actual.bits];
+    for (int anterior = 0; anterior < c; anterior++)
+    {
+        const candidato &otro = obtenerCandidato(anterior);
+        funcionByte g = obtenerOperacion(otro.operacion).byteDirecta[otro.bits];
+        bool igual = true;
+        for (int x = 0; x < 256 && igual; x++)
+        {
+            for (int m = 0; m < 256 && igual; m++)
+            {
+                igual = f((unsigned char)x, (unsigned char)m) == g((unsigned char)x, (unsigned char)m);
+            }
+        }
+        if (igual)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+bool generarCaso(const QString &rutaDirectorio, const parametrosGenerador &p, poolHilos &pool, ostream &salida)
+{
+    /*
+     * @brief Genera un caso sintetico completo a partir de una cadena aleatoria de transformaciones.
+     *
+     * Esta función crea una imagen original y las mascaras I_M y M con bytes pseudoaleatorios, elige al
+     * azar una operacion sin perdida del registro y una posicion para la ventana por cada etapa, y codifica
+     * el caso con codificarCaso, de modo que tiene la misma forma que los de 'data/'.
+     *
+     * En el directorio quedan I_D.bmp, I_M.bmp, M.bmp, los archivos M<i>.txt, la imagen que debe
+     * reconstruirse (I_O_esperada.bmp) y cadena.txt con la transformacion de cada etapa, en el orden y con
+     * el texto con que la reporta la reconstruccion.
+     *
+     * @param rutaDirectorio Directorio del caso; se crea si no existe.
+     * @param p Tamaño de las imagenes, cantidad de etapas, tamaño de las ventanas y semilla.
+     * @param pool Pool de hilos en el que se codifica el caso.
+     * @param salida Flujo en el que se informan los errores.
+     *
+     * @return true si se escribieron todos los archivos; false en caso contrario.
+     *
+     * @note Solo se usan operaciones sin perdida: con un desplazamiento, la imagen original no puede
+     *       reconstruirse completa y el caso no serviria para comparar resultados.
+     */
+
+    if (p.ancho <= 0 || p.alto <= 0 || p.etapas <= 0 || p.pixelesVentana <= 0 || p.pixelesVentana > (long long)p.ancho * p.alto)
+    {
+        salida << "Parametros invalidos para generar el caso" << endl;
+        return false;
+    }
+
+    // Las semillas de los archivos M<i>.txt son int: la ultima posicion de una ventana debe caber en uno
+    const size_t totalBytes = (size_t)p.ancho * p.alto * 3;
+    const size_t maximoSeed = totalBytes - (size_t)p.pixelesVentana * 3;
+    if (maximoSeed > (size_t)INT_MAX)
+    {
+        salida << "La imagen es demasiado grande: las semillas de las ventanas no caben en un int" << endl;
+        return false;
+    }
+    if (!QDir(".").mkpath(rutaDirectorio))
+    {
+        salida << "No se pudo crear " << rutaDirectorio.toStdString() << endl;
+        return false;
+    }
+
+    mt19937 aleatorio(p.semilla);
+    unsigned char *original = new unsigned char[totalBytes];
+    unsigned char *IM = new unsigned char[totalBytes];
+    unsigned char *M = new unsigned char[totalBytes];
+    for (size_t i = 0; i < totalBytes; i++)
+    {
+        original[i] = (unsigned char)aleatorio();
+        IM[i] = (unsigned char)aleatorio();
+        M[i] = (unsigned char)aleatorio();
+    }
+
+    // Solo se eligen candidatos sin perdida y distintos de todos los anteriores (por ejemplo, una rotacion
+    // de 4 bits a la derecha es igual a una a la izquierda), para que cadena.txt coincida con lo reportado
+    vector<int> elegibles;
+    for (int c = 0; c < cantidadCandidatos(); c++)
+    {
+        if (obtenerOperacion(obtenerCandidato(c).operacion).sinPerdida && !equivaleAAnterior(c))
+        {
+            elegibles.push_back(c);
+        }
+    }
+
+    vector<int> seeds;
+    vector<candidato> cadena;
+    for (int j = 0; j < p.etapas; j++)
+    {
+        seeds.push_back((int)(aleatorio() % (maximoSeed + 1)));
+        cadena.push_back(obtenerCandidato(elegibles[aleatorio() % elegibles.size()]));
+    }
+
+    bmp bmp;
+    bool correcto = bmp.exportImage(IM, p.ancho, p.alto, rutaDirectorio + "/I_M.bmp")
+                    && bmp.exportImage(M, p.ancho, p.alto, rutaDirectorio + "/M.bmp")
+                    && bmp.exportImage(original, p.ancho, p.alto, rutaDirectorio + "/I_O_esperada.bmp");
+    if (!correcto)
+    {
+        salida << "No se pudieron escribir los archivos de " << rutaDirectorio.toStdString() << endl;
+    }
+    correcto = correcto && codificarCaso(rutaDirectorio, original, IM, M, p.ancho, p.alto, cadena, seeds, p.pixelesVentana, pool, salida);
+
+    delete[] original;
+    delete[] IM;
+    delete[] M;
+    return correcto;
+}
+
+bool pruebaCodificador(poolHilos &pool)
+{
+    /*
+     * @brief Codifica casos sinteticos con generarCaso y comprueba que la reconstruccion los deshace.
+     *
+     * Cada caso usa una cadena sin perdida, de modo que la imagen reconstruida debe ser igual byte a byte a
+     * I_O_esperada.bmp, y las lineas "La transformacion ..." que imprime reconstruirCaso deben ser las de
+     * cadena.txt. Los tamaños incluyen anchos cuyas filas necesitan relleno en el BMP. Ademas, un caso
+     * codificado con --cadena "despIzq:3,xor,despDer:1" (con perdida, asi que no se reconstruye) debe dar
+     * una I_D igual, byte a byte, a esas transformaciones calculadas aqui. Los casos se escriben en un
+     * directorio temporal que se borra al terminar.
+     *
+     * @param pool Pool de hilos en el que se codifican y reconstruyen los casos.
+     *
+     * @return true si todos los casos se reconstruyeron exactamente; false en caso contrario.
+     */
+
+    struct casoPrueba
+    {
+        int ancho;
+        int alto;
+        int etapas;
+        int pixelesVentana;
+        unsigned semilla;
+    };
+    const casoPrueba casos[] = {{8, 8, 1, 20, 1}, {61, 37, 5, 200, 2}, {130, 17, 9, 300, 3}};
+
+    QTemporaryDir temporal;
+    if (!temporal.isValid())
+    {
+        return false;
+    }
+
+    bool correcto = true;
+    for (size_t k = 0; k < sizeof(casos) / sizeof(casos[0]) && correcto; k++)
+    {
+        parametrosGenerador p;
+        p.ancho = casos[k].ancho;
+        p.alto = casos[k].alto;
+        p.etapas = casos[k].etapas;
+        p.pixelesVentana = casos[k].pixelesVentana;
+        p.semilla = casos[k].semilla;
+
+        QString directorio = temporal.path() + "/caso" + QString::number((int)k);
+        ostringstream mensajes;
+        ostringstream reporte;
+        correcto = generarCaso(directorio, p, pool, mensajes) && reconstruirCaso(directorio, directorio + "/I_O.bmp", pool, reporte);
+
+        // La imagen reconstruida debe ser la original
+        bmp bmp;
+        int ancho = 0;
+        int alto = 0;
+        int anchoEsperado = 0;
+        int altoEsperado = 0;
+        unsigned char *reconstruida = correcto ? bmp.loadPixels(directorio + "/I_O.bmp", ancho, alto) : nullptr;
+        unsigned char *esperada = correcto ? bmp.loadPixels(directorio + "/I_O_esperada.bmp", anchoEsperado, altoEsperado) : nullptr;
+        correcto = reconstruida != nullptr && esperada != nullptr && ancho == anchoEsperado && alto == altoEsperado
+                   && memcmp(reconstruida, esperada, (size_t)ancho * alto * 3) == 0;
+        delete[] reconstruida;
+        delete[] esperada;
+
+        // Y la cadena reportada, la que se uso para codificar
+        string reportada;
+        istringstream lineas(reporte.str());
+        for (string linea; getline(lineas, linea);)
+        {
+            if (linea.compare(0, 17, "La transformacion") == 0)
+            {
+                reportada += linea + "\n";
+            }
+        }
+        QFile archivoCadena(directorio + "/cadena.txt");
+        if (correcto && archivoCadena.open(QIODevice::ReadOnly))
+        {
+            QByteArray contenido = archivoCadena.readAll();
+            correcto = reportada == string(contenido.constData(), (size_t)contenido.size());
+        }
+        else
+        {
+            correcto = false;
+        }
+    }
+
+    // Los desplazamientos de --cadena deben ir en la direccion que nombran
+    const int ancho = 9;
+    const int alto = 5;
+    const size_t totalBytes = (size_t)ancho * alto * 3;
+    unsigned char *original = new unsigned char[totalBytes];
+    unsigned char *IM = new unsigned char[totalBytes];
+    unsigned char *M = new unsigned char[totalBytes];
+    for (size_t i = 0; i < totalBytes; i++)
+    {
+        original[i] = (unsigned char)(i * 37 + 11);
+        IM[i] = (unsigned char)(i * 101 + 7);
+        M[i] = (unsigned char)(i * 13);
+    }
+    vector<candidato> cadena;
+    const vector<int> seeds = {0, 30, 60};
+    QString directorio = temporal.path() + "/desplazamientos";
+    ostringstream mensajes;
+    correcto = correcto && interpretarCadena("despIzq:3,xor,despDer:1", cadena) && QDir(".").mkpath(directorio)
+               && codificarCaso(directorio, original, IM, M, ancho, alto, cadena, seeds, 20, pool, mensajes);
+
+    bmp bmp;
+    int anchoID = 0;
+    int altoID = 0;
+    unsigned char *ID = correcto ? bmp.loadPixels(directorio + "/I_D.bmp", anchoID, altoID) : nullptr;
+    correcto = ID != nullptr && anchoID == ancho && altoID == alto;
+    for (size_t i = 0; i < totalBytes && correcto; i++)
+    {
+        correcto = ID[i] == (unsigned char)((unsigned char)((unsigned char)(original[i] << 3) ^ IM[i]) >> 1);
+    }
+    delete[] ID;
+    delete[] original;
+    delete[] IM;
+    delete[] M;
+    return correcto;
+}
@@ -0,0 +1,24 @@
+#ifndef GENERADOR_H
+#define GENERADOR_H
+
+#include <QString>
+
+#include <ostream>
+
+class poolHilos;
+
+struct parametrosGenerador
+{
+    int ancho;          // Ancho de las imagenes en pixeles
+    int alto;           // Alto de las imagenes en pixeles
+    int etapas;         // Cantidad de transformaciones (y de archivos M<i>.txt)
+    int pixelesVentana; // Pixeles enmascarados por etapa
+    unsigned semilla;   // Semilla del generador pseudoaleatorio; la misma semilla genera el mismo caso
+
+    parametrosGenerador();
+};
+
+bool generarCaso(const QString &rutaDirectorio, const parametrosGenerador &parametros, poolHilos &pool, std::ostream &salida);
+bool pruebaCodificador(poolHilos &pool);
+
+#endif // GENERADOR_H
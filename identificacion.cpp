@@ -0,0 +1,223 @@
+#include "identificacion.h"
+#include "operaciones.h"
+#include "traza.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+// Tablas del motor de identificacion, construidas una sola vez a partir del registro de operaciones
+struct tablasMotor
+{
+    // consistentes[x][y]: candidatos no posicionales cuya inversa lleva el byte x al byte y
+    mascaraCandidatos consistentes[256][256];
+
+    // Candidatos posicionales (los que leen I_M), que se evaluan byte a byte
+    vector<int> posicionales;
+    vector<funcionByte> funcionesPosicionales;
+    mascaraCandidatos mascaraPosicionales;
+
+    // Todos los candidatos del registro
+    mascaraCandidatos todos;
+
+    tablasMotor()
+    {
+        for (int x = 0; x < 256; x++)
+        {
+            for (int y = 0; y < 256; y++)
+            {
+                consistentes[x][y] = 0;
+            }
+        }
+
+        todos = 0;
+        mascaraPosicionales = 0;
+        for (int c = 0; c < cantidadCandidatos(); c++)
+        {
+            const candidato &cand = obtenerCandidato(c);
+            const descriptorOperacion &d = obtenerOperacion(cand.operacion);
+            funcionByte f = d.byteInversa[cand.bits];
+            todos |= 1ULL << c;
+            if (d.posicional)
+            {
+                posicionales.push_back(c);
+                funcionesPosicionales.push_back(f);
+                mascaraPosicionales |= 1ULL << c;
+                continue;
+            }
+            for (int x = 0; x < 256; x++)
+            {
+                consistentes[x][f((unsigned char)x, 0)] |= 1ULL << c;
+            }
+        }
+    }
+
+    // Candidatos consistentes con que el byte 'x' (con I_M 'm') deba convertirse en 'y'. Sin I_M los
+    // candidatos posicionales no pueden evaluarse y quedan descartados.
+    mascaraCandidatos byte(unsigned char x, const unsigned char *m, unsigned char y) const
+    {
+        mascaraCandidatos resultado = consistentes[x][y];
+        for (size_t p = 0; p < posicionales.size() && m != nullptr; p++)
+        {
+            if (funcionesPosicionales[p](x, *m) == y)
+            {
+                resultado |= 1ULL << posicionales[p];
+            }
+        }
+        return resultado;
+    }
+};
+
+const tablasMotor &tablas()
+{
+    static const tablasMotor t;
+    return t;
+}
+}
+
+mascaraCandidatos candidatosConsistentes(const unsigned char *ventana, const unsigned char *ventanaIM, const unsigned char *esperado, size_t bytes,
+                                         const unsigned int *muestra, int n_muestra)
+{
+    /*
+     * @brief Calcula, en una sola pasada por la ventana, todos los candidatos que la llevan a la esperada.
+     *
+     * En lugar de transformar la ventana con cada candidato y verificar el resultado, para cada byte se
+     * toma de una tabla de 256x256 la mascara de los candidatos no posicionales que llevan ventana[k] a
+     * esperado[k] (los posicionales se evaluan con su version de un byte) y se acumula el AND. Un candidato
+     * es consistente si su bit sobrevive a todos los bytes. Como el orden de los bits es el de los
+     * candidatos, el bit menos significativo es el mismo ganador que la prueba secuencial.
+     *
+     * @param ventana Los 'bytes' bytes de la imagen a destransformar.
+     * @param ventanaIM Los bytes de I_M de las mismas posiciones (nullptr si no hay operaciones posicionales que evaluar).
+     * @param esperado Ventana esperada (ver bmp::calcularPreimagen).
+     * @param bytes Tamaño de la ventana.
+     * @param muestra Posiciones que se evaluan antes que el resto, para descartar pronto los candidatos.
+     * @param n_muestra Cantidad de posiciones de la muestra.
+     *
+     * @return Mascara con un bit por cada candidato consistente; 0 si ninguno lo es.
+     */
+
+    TRAZA_ALCANCE("candidatosConsistentes");
+    const tablasMotor &t = tablas();
+    mascaraCandidatos acumulado = t.todos;
+
+    for (int k = 0; k < n_muestra && acumulado != 0; k++)
+    {
+        unsigned int p = muestra[k];
+        acumulado &= t.byte(ventana[p], ventanaIM != nullptr ? ventanaIM + p : nullptr, esperado[p]);
+    }
+
+    // Sin candidatos posicionales vivos basta con la tabla; el AND se revisa cada 64 bytes para cortar pronto
+    size_t k = 0;
+    while (k < bytes && acumulado != 0)
+    {
+        size_t fin = bytes - k < 64 ? bytes : k + 64;
+        if ((acumulado & t.mascaraPosicionales) == 0 || ventanaIM == nullptr)
+        {
+            for (; k < fin; k++)
+            {
+                acumulado &= t.consistentes[ventana[k]][esperado[k]];
+            }
+        }
+        else
+        {
+            for (; k < fin; k++)
+            {
+                acumulado &= t.byte(ventana[k], ventanaIM + k, esperado[k]);
+            }
+        }
+    }
+    TRAZA_SUMAR(traza::BYTES_VERIFICADOS, k);
+    return acumulado;
+}
+
+bool pruebaMotor()
+{
+    /*
+     * @brief Compara candidatosConsistentes contra la prueba por fuerza bruta de cada candidato.
+     *
+     * Esta función genera ventanas pseudoaleatorias de distintos tamaños (incluyendo colas que no llenan
+     * un bloque de 64 bytes), con valores de todo el rango y con pocos valores distintos (donde varios
+     * candidatos coinciden). Como ventana esperada se usa la transformacion de cada candidato y una
+     * ventana al azar; para cada una, la mascara del motor debe tener exactamente los candidatos cuya
+     * transformacion completa (ver aplicarCandidato) es igual a la esperada, con y sin muestra.
+     *
+     * @return true si el motor coincide con la fuerza bruta en todos los casos; false en caso contrario.
+     */
+
+    const size_t maximo = 4099;
+    const size_t tamanos[] = {1, 2, 3, 63, 64, 65, 127, 300, maximo};
+    const unsigned char mascarasValores[] = {0xFF, 0xF0, 0x81, 0x03};
+    unsigned char *ventana = new unsigned char[maximo];
+    unsigned char *ventanaIM = new unsigned char[maximo];
+    unsigned char *esperado = new unsigned char[maximo];
+    unsigned char *transformada = new unsigned char[maximo];
+    unsigned int muestra[3];
+
+    unsigned int estado = 12345;
+    bool correcto = true;
+    for (size_t bytes : tamanos)
+    {
+        for (unsigned char valores : mascarasValores)
+        {
+            for (size_t k = 0; k < bytes; k++)
+            {
+                estado = estado * 1103515245u + 12345u;
+                ventana[k] = (estado >> 16) & valores;
+                estado = estado * 1103515245u + 12345u;
+                ventanaIM[k] = estado >> 16;
+            }
+            for (int m = 0; m < 3; m++)
+            {
+                estado = estado * 1103515245u + 12345u;
+                muestra[m] = (estado >> 16) % bytes;
+            }
+
+            // La esperada es la transformacion de cada candidato y, al final, una ventana al azar
+            for (int e = 0; e <= cantidadCandidatos(); e++)
+            {
+                if (e < cantidadCandidatos())
+                {
+                    aplicarCandidato(obtenerCandidato(e), esperado, ventana, ventanaIM, bytes);
+                }
+                else
+                {
+                    for (size_t k = 0; k < bytes; k++)
+                    {
+                        estado = estado * 1103515245u + 12345u;
+                        esperado[k] = estado >> 16;
+                    }
+                }
+
+                mascaraCandidatos fuerzaBruta = 0;
+                for (int c = 0; c < cantidadCandidatos(); c++)
+                {
+                    aplicarCandidato(obtenerCandidato(c), transformada, ventana, ventanaIM, bytes);
+                    if (memcmp(transformada, esperado, bytes) == 0)
+                    {
+                        fuerzaBruta |= 1ULL << c;
+                    }
+                }
+
+                mascaraCandidatos motor = candidatosConsistentes(ventana, ventanaIM, esperado, bytes);
+                mascaraCandidatos conMuestra = candidatosConsistentes(ventana, ventanaIM, esperado, bytes, muestra, 3);
+                if (motor != fuerzaBruta || conMuestra != fuerzaBruta)
+                {
+                    cerr << "Diferencia con " << bytes << " bytes, esperada " << e << ": motor " << hex << motor << ", con muestra " << conMuestra
+                         << ", fuerza bruta " << fuerzaBruta << dec << endl;
+                    correcto = false;
+                }
+            }
+        }
+    }
+
+    delete[] ventana;
+    delete[] ventanaIM;
+    delete[] esperado;
+    delete[] transformada;
+    return correcto;
+}
@@ -0,0 +1,15 @@
+#ifndef IDENTIFICACION_H
+#define IDENTIFICACION_H
+
+#include <cstddef>
+
+// Conjunto de candidatos como mascara de bits: el bit c corresponde a obtenerCandidato(c)
+typedef unsigned long long mascaraCandidatos;
+
+const int MAX_CANDIDATOS_MOTOR = 64;
+
+mascaraCandidatos candidatosConsistentes(const unsigned char *ventana, const unsigned char *ventanaIM, const unsigned char *esperado, size_t bytes,
+                                         const unsigned int *muestra = nullptr, int n_muestra = 0);
+bool pruebaMotor();
+
+#endif // IDENTIFICACION_H
@@ -0,0 +1,496 @@
+#include "kernels.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+// Cada operacion byte a byte se expresa como (x << izquierda & mascaraIzquierda) | (x >> derecha & mascaraDerecha).
+// Asi las rotaciones y los desplazamientos comparten un unico kernel por nivel SIMD.
+struct parametrosBytes
+{
+    unsigned char izquierda;
+    unsigned char derecha;
+    unsigned char mascaraIzquierda;
+    unsigned char mascaraDerecha;
+};
+
+parametrosBytes parametrosRotacion(unsigned short int bits, bool haciaIzquierda)
+{
+    unsigned char b = bits % 8;
+    unsigned char izquierda = haciaIzquierda ? b : (8 - b) % 8;
+    parametrosBytes p;
+    p.izquierda = izquierda;
+    p.derecha = 8 - izquierda;
+    p.mascaraIzquierda = (0xFF << izquierda) & 0xFF;
+    p.mascaraDerecha = 0xFF >> p.derecha;
+    return p;
+}
+
+parametrosBytes parametrosDesplazamiento(unsigned short int bits, bool haciaIzquierda)
+{
+    unsigned char b = bits > 8 ? 8 : bits;
+    parametrosBytes p;
+    p.izquierda = haciaIzquierda ? b : 0;
+    p.derecha = haciaIzquierda ? 0 : b;
+    p.mascaraIzquierda = haciaIzquierda ? (0xFF << b) & 0xFF : 0;
+    p.mascaraDerecha = haciaIzquierda ? 0 : 0xFF >> b;
+    return p;
+}
+
+void bytesEscalar(unsigned char *destino, const unsigned char *origen, size_t totalBytes, parametrosBytes p)
+{
+    for (size_t i = 0; i < totalBytes; i++)
+    {
+        unsigned int x = origen[i];
+        destino[i] = ((x << p.izquierda) & p.mascaraIzquierda) | ((x >> p.derecha) & p.mascaraDerecha);
+    }
+}
+
+void xorEscalar(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    for (size_t i = 0; i < totalBytes; i++)
+    {
+        destino[i] = origen[i] ^ IM[i];
+    }
+}
+
+void buscarTablaEscalar(unsigned char *destino, const unsigned char *origen, const unsigned char *tabla256, size_t totalBytes)
+{
+    for (size_t i = 0; i < totalBytes; i++)
+    {
+        destino[i] = tabla256[origen[i]];
+    }
+}
+
+#ifdef KERNELS_X86
+// x86 no tiene desplazamientos de 8 bits: se desplaza en carriles de 16 bits y se enmascara
+// lo que cruza de un byte al vecino.
+__attribute__((target("sse2"))) void bytesSSE2(unsigned char *destino, const unsigned char *origen, size_t totalBytes, parametrosBytes p)
+{
+    const __m128i cuentaIzquierda = _mm_cvtsi32_si128(p.izquierda);
+    const __m128i cuentaDerecha = _mm_cvtsi32_si128(p.derecha);
+    const __m128i mascaraIzquierda = _mm_set1_epi8((char)p.mascaraIzquierda);
+    const __m128i mascaraDerecha = _mm_set1_epi8((char)p.mascaraDerecha);
+
+    size_t i = 0;
+    for (; i + 16 <= totalBytes; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(origen + i));
+        __m128i a = _mm_and_si128(_mm_sll_epi16(x, cuentaIzquierda), mascaraIzquierda);
+        __m128i b = _mm_and_si128(_mm_srl_epi16(x, cuentaDerecha), mascaraDerecha);
+        _mm_storeu_si128((__m128i *)(destino + i), _mm_or_si128(a, b));
+    }
+    bytesEscalar(destino + i, origen + i, totalBytes - i, p);
+}
+
+__attribute__((target("sse2"))) void xorSSE2(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    size_t i = 0;
+    for (; i + 16 <= totalBytes; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(origen + i));
+        __m128i m = _mm_loadu_si128((const __m128i *)(IM + i));
+        _mm_storeu_si128((__m128i *)(destino + i), _mm_xor_si128(x, m));
+    }
+    xorEscalar(destino + i, origen + i, IM + i, totalBytes - i);
+}
+
+__attribute__((target("avx2"))) void bytesAVX2(unsigned char *destino, const unsigned char *origen, size_t totalBytes, parametrosBytes p)
+{
+    const __m128i cuentaIzquierda = _mm_cvtsi32_si128(p.izquierda);
+    const __m128i cuentaDerecha = _mm_cvtsi32_si128(p.derecha);
+    const __m256i mascaraIzquierda = _mm256_set1_epi8((char)p.mascaraIzquierda);
+    const __m256i mascaraDerecha = _mm256_set1_epi8((char)p.mascaraDerecha);
+
+    size_t i = 0;
+    for (; i + 32 <= totalBytes; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(origen + i));
+        __m256i a = _mm256_and_si256(_mm256_sll_epi16(x, cuentaIzquierda), mascaraIzquierda);
+        __m256i b = _mm256_and_si256(_mm256_srl_epi16(x, cuentaDerecha), mascaraDerecha);
+        _mm256_storeu_si256((__m256i *)(destino + i), _mm256_or_si256(a, b));
+    }
+    bytesEscalar(destino + i, origen + i, totalBytes - i, p);
+}
+
+__attribute__((target("avx2"))) void xorAVX2(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    size_t i = 0;
+    for (; i + 32 <= totalBytes; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(origen + i));
+        __m256i m = _mm256_loadu_si256((const __m256i *)(IM + i));
+        _mm256_storeu_si256((__m256i *)(destino + i), _mm256_xor_si256(x, m));
+    }
+    xorEscalar(destino + i, origen + i, IM + i, totalBytes - i);
+}
+
+// Busqueda en una tabla de 256 entradas con pshufb, que solo indexa 16 entradas: la tabla se divide en
+// 16 subtablas y, para la subtabla h, el indice (x ^ h<<4) + 0x70 con saturacion deja el bit 7 en 1 (lo
+// que hace que pshufb retorne 0) en todos los bytes cuyo nibble alto no es h.
+__attribute__((target("avx2"))) void buscarTablaAVX2(unsigned char *destino, const unsigned char *origen, const unsigned char *tabla256, size_t totalBytes)
+{
+    __m256i subtablas[16];
+    for (int h = 0; h < 16; h++)
+    {
+        subtablas[h] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(tabla256 + 16 * h)));
+    }
+    const __m256i sesgo = _mm256_set1_epi8(0x70);
+
+    size_t i = 0;
+    for (; i + 32 <= totalBytes; i += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(origen + i));
+        __m256i resultado = _mm256_setzero_si256();
+        for (int h = 0; h < 16; h++)
+        {
+            __m256i indice = _mm256_adds_epu8(_mm256_xor_si256(x, _mm256_set1_epi8((char)(h << 4))), sesgo);
+            resultado = _mm256_or_si256(resultado, _mm256_shuffle_epi8(subtablas[h], indice));
+        }
+        _mm256_storeu_si256((__m256i *)(destino + i), resultado);
+    }
+    buscarTablaEscalar(destino + i, origen + i, tabla256, totalBytes - i);
+}
+
+// Con AVX-512BW la cola se procesa con cargas y escrituras enmascaradas, sin bucle escalar
+__attribute__((target("avx512f,avx512bw"))) void bytesAVX512(unsigned char *destino, const unsigned char *origen, size_t totalBytes, parametrosBytes p)
+{
+    const __m128i cuentaIzquierda = _mm_cvtsi32_si128(p.izquierda);
+    const __m128i cuentaDerecha = _mm_cvtsi32_si128(p.derecha);
+    const __m512i mascaraIzquierda = _mm512_set1_epi8((char)p.mascaraIzquierda);
+    const __m512i mascaraDerecha = _mm512_set1_epi8((char)p.mascaraDerecha);
+
+    for (size_t i = 0; i < totalBytes; i += 64)
+    {
+        size_t restantes = totalBytes - i;
+        __mmask64 k = restantes >= 64 ? ~(__mmask64)0 : (((__mmask64)1 << restantes) - 1);
+        __m512i x = _mm512_maskz_loadu_epi8(k, origen + i);
+        __m512i a = _mm512_and_si512(_mm512_sll_epi16(x, cuentaIzquierda), mascaraIzquierda);
+        __m512i b = _mm512_and_si512(_mm512_srl_epi16(x, cuentaDerecha), mascaraDerecha);
+        _mm512_mask_storeu_epi8(destino + i, k, _mm512_or_si512(a, b));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw"))) void xorAVX512(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    for (size_t i = 0; i < totalBytes; i += 64)
+    {
+        size_t restantes = totalBytes - i;
+        __mmask64 k = restantes >= 64 ? ~(__mmask64)0 : (((__mmask64)1 << restantes) - 1);
+        __m512i x = _mm512_maskz_loadu_epi8(k, origen + i);
+        __m512i m = _mm512_maskz_loadu_epi8(k, IM + i);
+        _mm512_mask_storeu_epi8(destino + i, k, _mm512_xor_si512(x, m));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw"))) void buscarTablaAVX512(unsigned char *destino, const unsigned char *origen, const unsigned char *tabla256, size_t totalBytes)
+{
+    __m512i subtablas[16];
+    unsigned char replica[64];
+    for (int h = 0; h < 16; h++)
+    {
+        for (int carril = 0; carril < 4; carril++)
+        {
+            memcpy(replica + 16 * carril, tabla256 + 16 * h, 16);
+        }
+        subtablas[h] = _mm512_loadu_si512(replica);
+    }
+    const __m512i sesgo = _mm512_set1_epi8(0x70);
+
+    for (size_t i = 0; i < totalBytes; i += 64)
+    {
+        size_t restantes = totalBytes - i;
+        __mmask64 k = restantes >= 64 ? ~(__mmask64)0 : (((__mmask64)1 << restantes) - 1);
+        __m512i x = _mm512_maskz_loadu_epi8(k, origen + i);
+        __m512i resultado = _mm512_setzero_si512();
+        for (int h = 0; h < 16; h++)
+        {
+            __m512i indice = _mm512_adds_epu8(_mm512_xor_si512(x, _mm512_set1_epi8((char)(h << 4))), sesgo);
+            resultado = _mm512_or_si512(resultado, _mm512_shuffle_epi8(subtablas[h], indice));
+        }
+        _mm512_mask_storeu_epi8(destino + i, k, resultado);
+    }
+}
+#endif
+
+struct tablaKernels
+{
+    void (*bytes)(unsigned char *, const unsigned char *, size_t, parametrosBytes);
+    void (*xorBytes)(unsigned char *, const unsigned char *, const unsigned char *, size_t);
+    void (*tablaBytes)(unsigned char *, const unsigned char *, const unsigned char *, size_t);
+};
+
+// SSE2 no tiene pshufb (es de SSSE3), por lo que en ese nivel la tabla usa la version escalar
+const tablaKernels tablaEscalar = {bytesEscalar, xorEscalar, buscarTablaEscalar};
+#ifdef KERNELS_X86
+const tablaKernels tablaSSE2 = {bytesSSE2, xorSSE2, buscarTablaEscalar};
+const tablaKernels tablaAVX2 = {bytesAVX2, xorAVX2, buscarTablaAVX2};
+const tablaKernels tablaAVX512 = {bytesAVX512, xorAVX512, buscarTablaAVX512};
+#endif
+
+const tablaKernels *tablaDeNivel(kernels::nivelSIMD nivel)
+{
+    switch (nivel)
+    {
+#ifdef KERNELS_X86
+    case kernels::NIVEL_AVX512:
+        return &tablaAVX512;
+    case kernels::NIVEL_AVX2:
+        return &tablaAVX2;
+    case kernels::NIVEL_SSE2:
+        return &tablaSSE2;
+#endif
+    default:
+        return &tablaEscalar;
+    }
+}
+
+kernels::nivelSIMD detectarNivel()
+{
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    {
+        return kernels::NIVEL_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return kernels::NIVEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return kernels::NIVEL_SSE2;
+    }
+#endif
+    return kernels::NIVEL_ESCALAR;
+}
+
+kernels::nivelSIMD nivelInicial()
+{
+    // La variable de entorno DESAFIO_SIMD permite limitar el nivel (escalar, sse2, avx2 o avx512)
+    kernels::nivelSIMD nivel = kernels::nivelDisponible();
+    const char *forzado = getenv("DESAFIO_SIMD");
+    if (forzado != nullptr)
+    {
+        for (int n = kernels::NIVEL_ESCALAR; n <= kernels::NIVEL_AVX512; n++)
+        {
+            if (strcmp(forzado, kernels::nombreNivel((kernels::nivelSIMD)n)) == 0 && n <= nivel)
+            {
+                return (kernels::nivelSIMD)n;
+            }
+        }
+    }
+    return nivel;
+}
+
+atomic<int> &nivelSeleccionado()
+{
+    static atomic<int> nivel(nivelInicial());
+    return nivel;
+}
+
+const tablaKernels *tablaActual()
+{
+    return tablaDeNivel((kernels::nivelSIMD)nivelSeleccionado().load(memory_order_relaxed));
+}
+}
+
+namespace kernels
+{
+void rotarIzquierda(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes)
+{
+    tablaActual()->bytes(destino, origen, totalBytes, parametrosRotacion(bits, true));
+}
+
+void rotarDerecha(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes)
+{
+    tablaActual()->bytes(destino, origen, totalBytes, parametrosRotacion(bits, false));
+}
+
+void desplazamientoIzquierda(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes)
+{
+    tablaActual()->bytes(destino, origen, totalBytes, parametrosDesplazamiento(bits, true));
+}
+
+void desplazamientoDerecha(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes)
+{
+    tablaActual()->bytes(destino, origen, totalBytes, parametrosDesplazamiento(bits, false));
+}
+
+void XOR(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    tablaActual()->xorBytes(destino, origen, IM, totalBytes);
+}
+
+void tabla(unsigned char *destino, const unsigned char *origen, const unsigned char *tabla256, size_t totalBytes)
+{
+    tablaActual()->tablaBytes(destino, origen, tabla256, totalBytes);
+}
+
+namespace escalar
+{
+void rotarIzquierda(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes)
+{
+    bytesEscalar(destino, origen, totalBytes, parametrosRotacion(bits, true));
+}
+
+void rotarDerecha(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes)
+{
+    bytesEscalar(destino, origen, totalBytes, parametrosRotacion(bits, false));
+}
+
+void desplazamientoIzquierda(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes)
+{
+    bytesEscalar(destino, origen, totalBytes, parametrosDesplazamiento(bits, true));
+}
+
+void desplazamientoDerecha(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes)
+{
+    bytesEscalar(destino, origen, totalBytes, parametrosDesplazamiento(bits, false));
+}
+
+void XOR(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    xorEscalar(destino, origen, IM, totalBytes);
+}
+
+void tabla(unsigned char *destino, const unsigned char *origen, const unsigned char *tabla256, size_t totalBytes)
+{
+    buscarTablaEscalar(destino, origen, tabla256, totalBytes);
+}
+
+}
+
+nivelSIMD nivelDisponible()
+{
+    static const nivelSIMD nivel = detectarNivel();
+    return nivel;
+}
+
+nivelSIMD nivelActual()
+{
+    return (nivelSIMD)nivelSeleccionado().load();
+}
+
+bool forzarNivel(nivelSIMD nivel)
+{
+    /*
+     * @brief Fija el nivel SIMD que usan las versiones despachadas de los kernels.
+     *
+     * @param nivel Nivel a usar. Debe estar soportado por la CPU.
+     *
+     * @return true si el nivel se pudo fijar; false si la CPU no lo soporta.
+     */
+
+    if (nivel > nivelDisponible())
+    {
+        return false;
+    }
+    nivelSeleccionado().store(nivel);
+    return true;
+}
+
+const char *nombreNivel(nivelSIMD nivel)
+{
+    switch (nivel)
+    {
+    case NIVEL_SSE2:
+        return "sse2";
+    case NIVEL_AVX2:
+        return "avx2";
+    case NIVEL_AVX512:
+        return "avx512";
+    default:
+        return "escalar";
+    }
+}
+
+bool pruebaDiferencial()
+{
+    /*
+     * @brief Compara cada nivel SIMD disponible contra la version escalar.
+     *
+     * Esta función aplica las cinco operaciones y la busqueda en tabla, para todas las cantidades de bits de 0 a 8, sobre
+     * arreglos pseudoaleatorios de distintos tamaños (incluyendo colas que no llenan un vector) y
+     * verifica que cada nivel produzca exactamente el mismo resultado que la version escalar.
+     *
+     * @return true si todos los niveles coinciden con la version escalar; false en caso contrario.
+     */
+
+    const size_t maximo = 4099;
+    unsigned char *origen = new unsigned char[maximo];
+    unsigned char *IM = new unsigned char[maximo];
+    unsigned char *esperado = new unsigned char[maximo];
+    unsigned char *obtenido = new unsigned char[maximo];
+
+    unsigned int estado = 12345;
+    for (size_t i = 0; i < maximo; i++)
+    {
+        estado = estado * 1103515245u + 12345u;
+        origen[i] = estado >> 16;
+        estado = estado * 1103515245u + 12345u;
+        IM[i] = estado >> 16;
+    }
+
+    typedef void (*funcionBits)(unsigned char *, const unsigned char *, unsigned short int, size_t);
+    const funcionBits despachadas[4] = {rotarIzquierda, rotarDerecha, desplazamientoIzquierda, desplazamientoDerecha};
+    const funcionBits referencias[4] = {escalar::rotarIzquierda, escalar::rotarDerecha, escalar::desplazamientoIzquierda, escalar::desplazamientoDerecha};
+    const size_t tamanos[] = {0, 1, 15, 16, 17, 31, 33, 63, 64, 65, 127, 200, maximo};
+
+    nivelSIMD anterior = nivelActual();
+    bool correcto = true;
+    for (int nivel = NIVEL_ESCALAR; nivel <= nivelDisponible(); nivel++)
+    {
+        forzarNivel((nivelSIMD)nivel);
+        for (size_t totalBytes : tamanos)
+        {
+            for (int f = 0; f < 4; f++)
+            {
+                for (unsigned short int bits = 0; bits <= 8; bits++)
+                {
+                    referencias[f](esperado, origen, bits, totalBytes);
+                    despachadas[f](obtenido, origen, bits, totalBytes);
+                    if (memcmp(esperado, obtenido, totalBytes) != 0)
+                    {
+                        cerr << "Diferencia en el nivel " << nombreNivel((nivelSIMD)nivel) << ", operacion " << f << ", " << bits << " bits, " << totalBytes << " bytes" << endl;
+                        correcto = false;
+                    }
+                }
+            }
+            escalar::XOR(esperado, origen, IM, totalBytes);
+            XOR(obtenido, origen, IM, totalBytes);
+            if (memcmp(esperado, obtenido, totalBytes) != 0)
+            {
+                cerr << "Diferencia en el nivel " << nombreNivel((nivelSIMD)nivel) << ", XOR, " << totalBytes << " bytes" << endl;
+                correcto = false;
+            }
+
+            // Como tabla se usan los primeros 256 bytes de IM
+            escalar::tabla(esperado, origen, IM, totalBytes);
+            tabla(obtenido, origen, IM, totalBytes);
+            if (memcmp(esperado, obtenido, totalBytes) != 0)
+            {
+                cerr << "Diferencia en el nivel " << nombreNivel((nivelSIMD)nivel) << ", tabla, " << totalBytes << " bytes" << endl;
+                correcto = false;
+            }
+        }
+    }
+    forzarNivel(anterior);
+
+    delete[] origen;
+    delete[] IM;
+    delete[] esperado;
+    delete[] obtenido;
+    return correcto;
+}
+}
@@ -0,0 +1,45 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+
+// Kernels de las operaciones byte a byte (rotaciones, desplazamientos, XOR y tabla de 256 entradas).
+// Cada operacion tiene una version escalar y versiones SSE2/AVX2/AVX-512; la version
+// que se usa se elige en tiempo de ejecucion segun las capacidades de la CPU.
+namespace kernels
+{
+enum nivelSIMD
+{
+    NIVEL_ESCALAR,
+    NIVEL_SSE2,
+    NIVEL_AVX2,
+    NIVEL_AVX512
+};
+
+// Versiones despachadas (usan el mejor nivel disponible o el forzado con forzarNivel)
+void rotarIzquierda(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes);
+void rotarDerecha(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes);
+void desplazamientoIzquierda(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes);
+void desplazamientoDerecha(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes);
+void XOR(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes);
+void tabla(unsigned char *destino, const unsigned char *origen, const unsigned char *tabla256, size_t totalBytes);
+
+// Versiones escalares, usadas como respaldo y como referencia para las pruebas diferenciales
+namespace escalar
+{
+void rotarIzquierda(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes);
+void rotarDerecha(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes);
+void desplazamientoIzquierda(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes);
+void desplazamientoDerecha(unsigned char *destino, const unsigned char *origen, unsigned short int bits, size_t totalBytes);
+void XOR(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes);
+void tabla(unsigned char *destino, const unsigned char *origen, const unsigned char *tabla256, size_t totalBytes);
+}
+
+nivelSIMD nivelDisponible();
+nivelSIMD nivelActual();
+bool forzarNivel(nivelSIMD nivel);
+const char *nombreNivel(nivelSIMD nivel);
+bool pruebaDiferencial();
+}
+
+#endif // KERNELS_H
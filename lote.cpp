@@ -0,0 +1,205 @@
+#include "lote.h"
+#include "memoria.h"
+#include "pool.h"
+#include "precarga.h"
+#include "reconstruccion.h"
+#include "recursos.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+struct resultadoCaso
+{
+    QString directorio;
+    bool correcto;
+    double milisegundos;
+    string error; // Primer mensaje del caso cuando falla
+};
+
+// Lee de principio a fin los archivos de entrada de un caso, descartando su contenido, para que esten en
+// la cache de archivos del sistema cuando el caso empiece (en discos de red, la espera de E/S de un caso
+// se superpone asi con el computo de los anteriores)
+void leerArchivosCaso(const QString &directorio)
+{
+    QStringList archivos = QDir(directorio).entryList(QStringList() << "M*.txt" << "M*.bin", QDir::Files);
+    archivos << "I_D.bmp" << "I_M.bmp";
+    const qint64 tramo = 1 << 20;
+    char *buffer = new char[tramo];
+    for (const QString &nombre : archivos)
+    {
+        QFile archivo(directorio + "/" + nombre);
+        if (archivo.open(QIODevice::ReadOnly))
+        {
+            while (archivo.read(buffer, tramo) == tramo)
+            {
+            }
+        }
+    }
+    delete[] buffer;
+}
+
+// Quita los espacios al inicio y al final de una linea del manifiesto
+string recortar(const string &linea)
+{
+    size_t inicio = linea.find_first_not_of(" \t\r\n");
+    if (inicio == string::npos)
+    {
+        return string();
+    }
+    size_t fin = linea.find_last_not_of(" \t\r\n");
+    return linea.substr(inicio, fin - inicio + 1);
+}
+}
+
+bool reconstruirLote(const QString &manifiesto, poolHilos &pool, const opcionesReconstruccion &opciones)
+{
+    /*
+     * @brief Reconstruye todos los casos de un manifiesto, varios a la vez, en un solo proceso.
+     *
+     * El manifiesto tiene un directorio de caso por linea (las lineas vacias y las que empiezan con '#'
+     * se ignoran); las rutas relativas se toman desde el directorio del manifiesto. Cada caso es una tarea
+     * del pool y sus bloques son tareas anidadas, que el robo de trabajo reparte entre los hilos libres.
+     * Los casos cuyos I_M.bmp son el mismo archivo (por ejemplo, enlaces a una copia comun) comparten la
+     * imagen decodificada a traves de una cacheImagenes. Con un limite de memoria (opciones.memoria), cada
+     * caso se admite antes de encolarlo y cada I_M compartida se cuenta una sola vez.
+     *
+     * Por cada caso se escriben en su directorio I_O.bmp y resultado.txt (los mensajes que el modo normal
+     * imprime en pantalla); en pantalla se imprime una linea por caso, en el orden del manifiesto, y un resumen.
+     *
+     * @param manifiesto Ruta del archivo con la lista de directorios.
+     * @param pool Pool de hilos en el que se procesan los casos.
+     * @param opciones Opciones comunes a todos los casos; la cache de imagenes la crea el lote.
+     *
+     * @return true si todos los casos se reconstruyeron; false si alguno fallo o el manifiesto no pudo leerse.
+     */
+
+    ifstream archivo(manifiesto.toStdString());
+    if (!archivo.is_open())
+    {
+        cout << "No se pudo abrir el manifiesto " << manifiesto.toStdString() << endl;
+        return false;
+    }
+
+    QString base = QFileInfo(manifiesto).absolutePath();
+    vector<resultadoCaso> resultados;
+    string linea;
+    while (getline(archivo, linea))
+    {
+        linea = recortar(linea);
+        if (linea.empty() || linea[0] == '#')
+        {
+            continue;
+        }
+        QString directorio = linea[0] == '/' ? QString(linea.c_str()) : base + "/" + QString(linea.c_str());
+        resultados.push_back({directorio, false, 0.0, string()});
+    }
+
+    // Se anuncian a la cache todos los usos de cada I_M, para que se decodifique una sola vez
+    cacheImagenes cache;
+    imagenesAdmitidas imagenes(cache, opciones.memoria);
+    for (const resultadoCaso &r : resultados)
+    {
+        imagenes.anunciar(r.directorio + "/I_M.bmp");
+    }
+    opcionesReconstruccion opcionesCaso = opciones;
+    opcionesCaso.imagenes = &cache;
+    opcionesCaso.memoria = nullptr; // Los casos se admiten aqui, antes de encolarlos
+
+    // Los casos se encolan agrupados por I_M (y en el orden del manifiesto dentro de cada grupo): asi cada
+    // imagen se libera apenas terminan sus casos, y con un limite de memoria un caso nunca espera la
+    // reserva de una imagen que retienen casos que todavia no se admitieron
+    vector<size_t> orden(resultados.size());
+    vector<string> claves(resultados.size());
+    for (size_t k = 0; k < resultados.size(); k++)
+    {
+        orden[k] = k;
+        claves[k] = claveImagen(resultados[k].directorio + "/I_M.bmp");
+    }
+    stable_sort(orden.begin(), orden.end(), [&](size_t a, size_t b) { return claves[a] < claves[b]; });
+
+    // Mientras el pool trabaja en unos casos, un hilo lee por adelantado los archivos de los siguientes (a
+    // lo sumo 'precarga' casos leidos que todavia no empezaron); cada caso descarta su lectura al empezar
+    precargador lecturas(opciones.precarga);
+    for (size_t p = 0; opciones.precarga > 0 && p < orden.size(); p++)
+    {
+        QString directorio = resultados[orden[p]].directorio;
+        lecturas.agregar([directorio]() { leerArchivosCaso(directorio); });
+    }
+
+    // Con un limite de memoria, cada caso se admite en este hilo antes de encolarlo: se reserva su parte
+    // (y la de su I_M, si ningun caso admitido la comparte) esperando aqui, y no dentro de un hilo del
+    // pool, a que terminen los casos anteriores. El caso libera su reserva al terminar
+    vector<unique_ptr<reservaMemoria>> reservas(resultados.size());
+    vector<string> rechazos(resultados.size());
+    grupoTareas grupo;
+    for (size_t p = 0; p < orden.size(); p++)
+    {
+        size_t k = orden[p];
+        QString rutaIM = resultados[k].directorio + "/I_M.bmp";
+        size_t bytesCaso = 0;
+        size_t bytesIM = 0;
+        ostringstream rechazo;
+        if (opciones.memoria != nullptr && !estimarCaso(resultados[k].directorio, opciones, bytesCaso, bytesIM, rechazo))
+        {
+            rechazos[k] = rechazo.str();
+        }
+        else if (opciones.memoria != nullptr)
+        {
+            imagenes.admitir(rutaIM, bytesIM);
+            reservas[k].reset(new reservaMemoria(opciones.memoria, bytesCaso));
+        }
+
+        pool.ejecutar(grupo, [&, k, p, rutaIM]() {
+            resultadoCaso &r = resultados[k];
+            terminacionImagen terminacion = {imagenes, rutaIM};
+            if (opciones.precarga > 0)
+            {
+                lecturas.descartar((int)p);
+            }
+            chrono::steady_clock::time_point inicio = chrono::steady_clock::now();
+            ostringstream registro;
+            registro << rechazos[k];
+            r.correcto = rechazos[k].empty() && reconstruirCaso(r.directorio, r.directorio + "/I_O.bmp", pool, registro, opcionesCaso);
+            reservas[k].reset();
+            r.milisegundos = chrono::duration<double, milli>(chrono::steady_clock::now() - inicio).count();
+
+            ofstream salida((r.directorio + "/resultado.txt").toStdString());
+            salida << registro.str();
+            r.correcto = r.correcto && salida.good();
+            if (!r.correcto)
+            {
+                r.error = recortar(registro.str().substr(0, registro.str().find('\n')));
+            }
+        });
+    }
+    pool.esperar(grupo);
+
+    int correctos = 0;
+    for (const resultadoCaso &r : resultados)
+    {
+        cout << r.directorio.toStdString() << ": " << (r.correcto ? "reconstruido" : "error") << " (" << r.milisegundos << " ms)";
+        if (!r.correcto && !r.error.empty())
+        {
+            cout << ": " << r.error;
+        }
+        cout << endl;
+        correctos += r.correcto ? 1 : 0;
+    }
+    cout << correctos << " de " << resultados.size() << " casos reconstruidos; imagenes compartidas: "
+         << cache.cantidadCargas() << " cargadas, " << cache.cantidadAciertos() << " reutilizadas" << endl;
+
+    return correctos == (int)resultados.size();
+}
@@ -0,0 +1,12 @@
+#ifndef LOTE_H
+#define LOTE_H
+
+#include "reconstruccion.h"
+
+#include <QString>
+
+class poolHilos;
+
+bool reconstruirLote(const QString &manifiesto, poolHilos &pool, const opcionesReconstruccion &opciones = opcionesReconstruccion());
+
+#endif // LOTE_H
@@ -1,102 +1,315 @@
 #include <iostream>
+#include "benchmark.h"
 #include "bmp.h"
+#include "cacheoperaciones.h"
+#include "codificador.h"
+#include "generador.h"
+#include "identificacion.h"
+#include "kernels.h"
+#include "lote.h"
+#include "mascarabin.h"
+#include "memoria.h"
+#include "pool.h"
+#include "reconstruccion.h"
+#include "servicio.h"
+#include "streaming.h"
+#include "traza.h"
+#include <cstdlib>
+#include <cstring>
 using namespace std;
 
-int main()
+int main(int argc, char *argv[])
 {
-    bmp bmp;
-    // Definición de rutas y variables para cargar ID
-    QString I_D = "../../data/I_D.bmp";
-    int height_ID = 0;
-    int width_ID = 0;
-    unsigned char *ID = bmp.loadPixels(I_D, width_ID, height_ID);
-
-    // Definicion de la ruta y uso de la funcion para contar cuantos archivos .txt hay
-    QString ruta = "../../data";
-    int n = bmp.contarArchivosMascara(ruta) - 1;
+    // Opciones de la linea de comandos
+    int hilos = 0; // 0: un hilo por nucleo
+    bool streaming = false;
+    bool consistentes = false; // Listar todas las operaciones consistentes de cada etapa
+    bool busqueda = false;     // Explorar todas las cadenas consistentes en vez de quedarse con la primera
+    size_t presupuesto = 64u << 20; // Memoria para los bloques de filas en modo streaming
+    size_t memoriaMaxima = 0;       // Limite de memoria de todas las reconstrucciones (0: sin limite)
+    int precarga = opcionesReconstruccion().precarga; // Etapas (o casos, en modo por lotes) que se leen por adelantado
+    const char *manifiesto = nullptr; // Lista de directorios de casos para el modo por lotes
+    const char *generar = nullptr;    // Directorio en el que se genera un caso sintetico
+    const char *benchmark = nullptr;  // Directorio en el que se genera el caso del benchmark
+    const char *codificar = nullptr;  // Imagen original que se codifica con la cadena de --cadena
+    const char *destino = nullptr;    // Directorio del caso codificado
+    const char *textoCadena = nullptr; // Cadena de operaciones de --codificar, por ejemplo "xor,rotIzq:3"
+    const char *archivoTraza = nullptr; // JSON con la linea de tiempo (solo con DESAFIO_TRAZA)
+    const char *archivoCache = nullptr; // Cache persistente de las etapas ya identificadas
+    const char *socketServicio = nullptr; // Socket en el que el modo servicio atiende reconstrucciones
+    parametrosGenerador parametros;
+    int repeticiones = 5;
+    bool pruebaCodificadorPedida = false; // Se ejecuta despues de leer todas las opciones, con --hilos
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "--prueba-simd") == 0)
+        {
+            // Prueba diferencial de los kernels SIMD contra la version escalar
+            bool correcto = kernels::pruebaDiferencial();
+            cout << "Kernels (" << kernels::nombreNivel(kernels::nivelDisponible()) << "): " << (correcto ? "correctos" : "con diferencias") << endl;
+            return correcto ? 0 : 1;
+        }
+        else if (strcmp(argv[a], "--prueba-motor") == 0)
+        {
+            // Prueba del motor de identificacion contra la prueba de cada candidato por fuerza bruta
+            bool correcto = pruebaMotor();
+            cout << "Motor de identificacion (" << cantidadCandidatos() << " candidatos): " << (correcto ? "correcto" : "con diferencias") << endl;
+            return correcto ? 0 : 1;
+        }
+        else if (strcmp(argv[a], "--prueba-codificador") == 0)
+        {
+            pruebaCodificadorPedida = true;
+        }
+        else if (strcmp(argv[a], "--convertir") == 0 && a + 1 < argc)
+        {
+            // Conversion de los archivos M<i>.txt de un directorio al formato binario M<i>.bin
+            bmp bmp;
+            QString directorio = argv[++a];
+            int cantidad = bmp.contarArchivosMascara(directorio);
+            for (int i = 0; i < cantidad; i++)
+            {
+                QString base = directorio + "/M" + QString::number(i);
+                if (!mascaraBinaria::convertir(base + ".txt", base + ".bin"))
+                {
+                    cout << "No se pudo convertir " << (base + ".txt").toStdString() << endl;
+                    return 1;
+                }
+            }
+            cout << cantidad << " archivos convertidos" << endl;
+            return 0;
+        }
+        else if (strcmp(argv[a], "--hilos") == 0 && a + 1 < argc)
+        {
+            hilos = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--consistentes") == 0)
+        {
+            consistentes = true;
+        }
+        else if (strcmp(argv[a], "--busqueda") == 0)
+        {
+            busqueda = true;
+        }
+        else if (strcmp(argv[a], "--streaming") == 0)
+        {
+            streaming = true;
+        }
+        else if (strcmp(argv[a], "--servicio") == 0 && a + 1 < argc)
+        {
+            socketServicio = argv[++a];
+        }
+        else if (strcmp(argv[a], "--lote") == 0 && a + 1 < argc)
+        {
+            manifiesto = argv[++a];
+        }
+        else if (strcmp(argv[a], "--generar") == 0 && a + 1 < argc)
+        {
+            generar = argv[++a];
+        }
+        else if (strcmp(argv[a], "--codificar") == 0 && a + 2 < argc)
+        {
+            codificar = argv[++a];
+            destino = argv[++a];
+        }
+        else if (strcmp(argv[a], "--cadena") == 0 && a + 1 < argc)
+        {
+            textoCadena = argv[++a];
+        }
+        else if (strcmp(argv[a], "--benchmark") == 0 && a + 1 < argc)
+        {
+            benchmark = argv[++a];
+        }
+        else if (strcmp(argv[a], "--ancho") == 0 && a + 1 < argc)
+        {
+            parametros.ancho = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--alto") == 0 && a + 1 < argc)
+        {
+            parametros.alto = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--etapas") == 0 && a + 1 < argc)
+        {
+            parametros.etapas = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--ventana") == 0 && a + 1 < argc)
+        {
+            parametros.pixelesVentana = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--semilla") == 0 && a + 1 < argc)
+        {
+            parametros.semilla = (unsigned)strtoul(argv[++a], nullptr, 10);
+        }
+        else if (strcmp(argv[a], "--repeticiones") == 0 && a + 1 < argc)
+        {
+            repeticiones = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--traza") == 0 && a + 1 < argc)
+        {
+            archivoTraza = argv[++a];
+        }
+        else if (strcmp(argv[a], "--memoria") == 0 && a + 1 < argc)
+        {
+            memoriaMaxima = (size_t)atoll(argv[++a]) << 20;
+        }
+        else if (strcmp(argv[a], "--precarga") == 0 && a + 1 < argc)
+        {
+            precarga = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--cache") == 0 && a + 1 < argc)
+        {
+            archivoCache = argv[++a];
+        }
+        else if (strcmp(argv[a], "--presupuesto") == 0 && a + 1 < argc)
+        {
+            presupuesto = (size_t)atoll(argv[++a]) << 20;
+        }
+        else
+        {
+            cout << "Opcion desconocida: " << argv[a] << endl;
+            cout << "Uso: " << argv[0] << " [--hilos N] [--lote MANIFIESTO | --servicio SOCKET] [--streaming] [--consistentes] [--busqueda] [--presupuesto MB] [--memoria MB] [--precarga N] [--cache ARCHIVO] [--traza ARCHIVO.json] [--convertir DIRECTORIO] [--prueba-simd] [--prueba-motor] [--prueba-codificador]" << endl;
+            cout << "     " << argv[0] << " --generar DIRECTORIO | --benchmark DIRECTORIO [--ancho W] [--alto H] [--etapas N] [--ventana PIXELES] [--semilla S] [--repeticiones R]" << endl;
+            cout << "     " << argv[0] << " --codificar IMAGEN.bmp DIRECTORIO --cadena OPERACION[:BITS],... (transformaciones originales; despIzq/despDer desplazan a la izquierda/derecha) [--ventana PIXELES] [--semilla S] [--hilos N]" << endl;
+            return 1;
+        }
+    }
 
-    // Definicion de variables adicionales
-    unsigned char *IT = nullptr; // Puntero que va a probar las transformaciones para no afectar ID
-    int totalBytes = height_ID * width_ID * 3;
+    // Prueba de ida y vuelta: casos codificados con cadenas sin perdida deben reconstruirse exactamente
+    if (pruebaCodificadorPedida)
+    {
+        poolHilos pool(hilos);
+        bool correcto = pruebaCodificador(pool);
+        cout << "Codificacion y reconstruccion: " << (correcto ? "correctas" : "con diferencias") << endl;
+        return correcto ? 0 : 1;
+    }
 
-    for (int i = n; i >= 0; i--)
+    // Generacion de un caso sintetico con una cadena aleatoria de transformaciones
+    if (generar != nullptr)
     {
-        // Creacion del string con la direccion del archhivo .txt
-        QString name = "../../data/M" + QString::number(i) + ".txt";
+        poolHilos pool(hilos);
+        if (!generarCaso(generar, parametros, pool, cout))
+        {
+            return 1;
+        }
+        cout << "Caso generado en " << generar << endl;
+        return 0;
+    }
 
-        // Aplicacion del XOR y luego verificamos si es la transformacion adecuada
-        delete[] IT;
-        IT = bmp.XOR(ID);
-        if (bmp.verificarEnmascaramiento(IT, name.toStdString().c_str()))
+    // Codificacion de una imagen con una cadena dada de transformaciones
+    if (codificar != nullptr)
+    {
+        vector<candidato> cadena;
+        if (textoCadena == nullptr || !interpretarCadena(textoCadena, cadena))
         {
-            cout << "La transformacion " << n - i + 1 << " fue un XOR" << endl;
+            cout << "--codificar necesita una cadena valida (--cadena), por ejemplo --cadena xor,rotIzq:3,xor" << endl;
+            return 1;
         }
-        else
+        poolHilos pool(hilos);
+        if (!codificarImagen(codificar, destino, cadena, parametros, pool, cout))
         {
-            // Si la transformacion no es el XOR, pasa a evaluar las demas transformaciones
-            for (int bit = 1; bit <= 8; bit++)
-            {
-                //Aplicacion del desplazamiento a la derecha (inverso del desplazamiento a la izquierda) y validacion
-                delete[] IT;
-                IT = bmp.desplazamientoIzquierda(ID, bit, totalBytes);
+            return 1;
+        }
+        cout << "Caso codificado en " << destino << endl;
+        return 0;
+    }
 
-                if (bmp.verificarEnmascaramiento(IT, name.toStdString().c_str()))
-                {
-                    cout << "La transformacion " << n - i + 1 << " fue un desplazamiento a la izquierda de " << bit << " bits" << endl;
-                    break; // Sale del ciclo si la transformacion es correcta
-                }
+    // Benchmark de los kernels y de la reconstruccion, sobre un caso sintetico
+    if (benchmark != nullptr)
+    {
+        return ejecutarBenchmark(benchmark, parametros, repeticiones > 0 ? repeticiones : 1, hilos, cout) ? 0 : 1;
+    }
 
-                // Aplicacion del desplazamiento a la izquierda (inverso del desplazamiento a la derecha) y validacion
-                delete[] IT;
-                IT = bmp.desplazamientoDerecha(ID, bit, totalBytes);
+    if (socketServicio != nullptr && streaming)
+    {
+        cout << "--servicio no esta disponible en modo streaming" << endl;
+        return 1;
+    }
 
-                if (bmp.verificarEnmascaramiento(IT, name.toStdString().c_str()))
-                {
-                    cout << "La transformacion " << n - i + 1 << " fue un desplazamiento a la derecha de " << bit << " bits" << endl;
-                    break; // Sale del ciclo si la transformacion es correcta
-                }
+    if (busqueda && streaming)
+    {
+        cout << "--busqueda no esta disponible en modo streaming: las imagenes alternativas necesitan I_D completa en memoria" << endl;
+        return 1;
+    }
 
-                // Aplicacion de la rotacion derecha (inverso de la rotacion izquierda) y validacion
-                delete[] IT;
-                IT = bmp.rotarDerecha(ID, bit, totalBytes);
+    if (archivoTraza != nullptr && !traza::disponible())
+    {
+        cerr << "--traza no tiene efecto: el programa se compilo sin la instrumentacion (CONFIG += traza)" << endl;
+        archivoTraza = nullptr;
+    }
 
-                if (bmp.verificarEnmascaramiento(IT, name.toStdString().c_str()))
-                {
-                    cout << "La transformacion " << n - i + 1 << " fue una rotacion a la izquierda de " << bit << " bits" << endl;
-                    break; // Sale del ciclo si la transformacion es correcta
-                }
+    // Con --cache las etapas ya identificadas en una ejecucion anterior (aunque se haya interrumpido) no se repiten
+    cacheOperaciones operaciones;
+    opcionesReconstruccion opciones;
+    opciones.reportarConsistentes = consistentes;
+    opciones.busqueda = busqueda;
+    opciones.precarga = precarga;
+    if (archivoCache != nullptr)
+    {
+        if (!operaciones.abrir(archivoCache))
+        {
+            cout << "No se pudo abrir la cache " << archivoCache << endl;
+            return 1;
+        }
+        opciones.operaciones = &operaciones;
+    }
 
-                // Aplicacion de la rotacion izquierda (inverso de la rotacion derecha) y validacion
-                delete[] IT;
-                IT = bmp.rotarIzquierda(ID, bit, totalBytes);
+    // Con --memoria cada caso reserva su parte del limite antes de cargar nada, y falla si no le alcanza
+    limiteMemoria limite(memoriaMaxima);
+    if (memoriaMaxima > 0)
+    {
+        opciones.memoria = &limite;
+    }
 
-                if (bmp.verificarEnmascaramiento(IT, name.toStdString().c_str()))
-                {
-                    cout << "La transformacion " << n - i + 1 << " fue una rotacion a la derecha de " << bit << " bits" << endl;
-                    break; // Sale del ciclo si la transformacion es correcta
-                }
+    int codigo = 0;
+    {
+        poolHilos pool(hilos);
+        if (socketServicio != nullptr)
+        {
+            // En modo servicio el proceso queda residente y atiende los casos que llegan por el socket
+            codigo = ejecutarServicio(socketServicio, pool, opciones, cout) ? 0 : 1;
+        }
+        else if (manifiesto != nullptr)
+        {
+            // En modo por lotes se reconstruyen todos los casos del manifiesto en este mismo proceso
+            codigo = reconstruirLote(manifiesto, pool, opciones) ? 0 : 1;
+        }
+        else if (streaming)
+        {
+            // En modo streaming las imagenes se procesan por bloques y nunca se cargan completas
+            if (reconstruirStreaming("../../data", "../../data/I_O.bmp", presupuesto, pool, opciones))
+            {
+                cout << "Imagen original reconstruida correctamente" << endl;
+            }
+            else
+            {
+                cout << "Ocurrio un error al reconstruir la imagen" << endl;
+                codigo = 1;
             }
         }
-        // Se elimina ID y le asigno IT, pues en este punto IT ya esta destransformado
-        delete[] ID;
-        ID = bmp.copiarArreglo(IT, totalBytes);
+        else
+        {
+            // Reconstruccion de un caso con las imagenes completas en memoria
+            codigo = reconstruirCaso("../../data", "../../data/I_O.bmp", pool, cout, opciones) ? 0 : 1;
+        }
     }
-    // Se libera IT
-    delete[] IT;
 
-    // Exportando ID, en este punto ya es IO
-    QString I_O = "../../data/I_O.bmp";
-    if (bmp.exportImage(ID, width_ID, height_ID, I_O))
+    if (memoriaMaxima > 0)
     {
-        cout << "Imagen original reconstruida correctamente" << endl;
+        cout << "Memoria maxima usada: " << megabytes(memoriaPico()) << " MB (limite: " << megabytes(memoriaMaxima) << " MB)" << endl;
     }
-    else
+    if (archivoCache != nullptr)
     {
-        cout << "Ocurrio un error al reconstruir la imagen" << endl;
+        cout << "Cache de operaciones: " << operaciones.cantidadAciertos() << " etapas reutilizadas, " << operaciones.cantidadNuevas() << " nuevas" << endl;
     }
 
-    //Se libera ID
-    delete[] ID;
-
-    return 0;
+    // La traza se exporta cuando ya terminaron todos los hilos del pool; el resumen se imprime siempre
+    // que el programa se compilo con la instrumentacion
+    if (archivoTraza != nullptr && !traza::exportarJSON(archivoTraza))
+    {
+        cout << "No se pudo escribir " << archivoTraza << endl;
+    }
+    if (traza::disponible())
+    {
+        traza::imprimirResumen(cout);
+    }
+    return codigo;
 }
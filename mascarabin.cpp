@@ -0,0 +1,213 @@
+#include "mascarabin.h"
+#include "bmp.h"
+#include "traza.h"
+
+#include <QtGlobal>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+namespace
+{
+const char FIRMA[4] = {'D', 'S', 'M', '1'};
+const unsigned int VERSION = 1;
+
+unsigned short int aLittleEndian(unsigned short int v)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    return (unsigned short int)((v >> 8) | (v << 8));
+#else
+    return v;
+#endif
+}
+
+unsigned int aLittleEndian(unsigned int v)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+#else
+    return v;
+#endif
+}
+}
+
+mascaraBinaria::mascaraBinaria() : valores(nullptr), copia(nullptr), semilla(0), pixeles(0)
+{
+}
+
+mascaraBinaria::~mascaraBinaria()
+{
+    cerrar();
+}
+
+bool mascaraBinaria::abrir(const QString &nombreArchivo, bool verificarSuma)
+{
+    /*
+     * @brief Abre un archivo de enmascaramiento binario sin copiar sus datos.
+     *
+     * Esta función mapea el archivo en memoria, valida la cabecera y, si se pide, la suma de verificacion.
+     * Las sumas R, G, B quedan disponibles en datos() apuntando directamente al mapeo, listas para
+     * pasarse a bmp::verificarEnmascaramiento.
+     *
+     * @param nombreArchivo Ruta del archivo M<i>.bin.
+     * @param verificarSuma true para validar la suma de verificacion de los datos.
+     *
+     * @return true si el archivo es valido; false en caso contrario (el motivo se informa por cerr).
+     *
+     * @note Los datos son validos mientras el objeto siga abierto.
+     */
+
+    cerrar();
+    archivo.setFileName(nombreArchivo);
+    if (!archivo.open(QIODevice::ReadOnly) || archivo.size() < (qint64)sizeof(cabeceraMascaraBinaria))
+    {
+        return false;
+    }
+
+    TRAZA_ALCANCE("mascaraBinaria::abrir");
+    qint64 tamano = archivo.size();
+    TRAZA_SUMAR(traza::BYTES_LEIDOS, tamano);
+    const unsigned char *mapa = archivo.map(0, tamano);
+    if (mapa == nullptr)
+    {
+        return false;
+    }
+
+    cabeceraMascaraBinaria cabecera;
+    memcpy(&cabecera, mapa, sizeof(cabecera));
+    if (memcmp(cabecera.firma, FIRMA, 4) != 0 || aLittleEndian(cabecera.version) != VERSION)
+    {
+        cerr << nombreArchivo.toStdString() << ": no es un archivo de enmascaramiento binario valido" << endl;
+        cerrar();
+        return false;
+    }
+
+    semilla = aLittleEndian(cabecera.seed);
+    pixeles = aLittleEndian(cabecera.n_pixels);
+    size_t bytesDatos = (size_t)pixeles * 3 * sizeof(unsigned short int);
+    if ((qint64)(sizeof(cabecera) + bytesDatos) != tamano)
+    {
+        cerr << nombreArchivo.toStdString() << ": el tamaño no coincide con la cabecera" << endl;
+        cerrar();
+        return false;
+    }
+
+    const unsigned char *inicioDatos = mapa + sizeof(cabecera);
+    if (verificarSuma && calcularSuma(inicioDatos, bytesDatos) != aLittleEndian(cabecera.suma))
+    {
+        cerr << nombreArchivo.toStdString() << ": la suma de verificacion no coincide" << endl;
+        cerrar();
+        return false;
+    }
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    // En big endian los valores deben invertirse, por lo que no se pueden usar desde el mapeo
+    copia = new unsigned short int[(size_t)pixeles * 3];
+    memcpy(copia, inicioDatos, bytesDatos);
+    for (size_t k = 0; k < (size_t)pixeles * 3; k++)
+    {
+        copia[k] = aLittleEndian(copia[k]);
+    }
+    valores = copia;
+#else
+    valores = (const unsigned short int *)inicioDatos;
+#endif
+    return true;
+}
+
+void mascaraBinaria::cerrar()
+{
+    archivo.close();
+    delete[] copia;
+    copia = nullptr;
+    valores = nullptr;
+    semilla = 0;
+    pixeles = 0;
+}
+
+const unsigned short int *mascaraBinaria::datos() const
+{
+    return valores;
+}
+
+int mascaraBinaria::seed() const
+{
+    return semilla;
+}
+
+int mascaraBinaria::n_pixels() const
+{
+    return pixeles;
+}
+
+bool mascaraBinaria::escribir(const QString &nombreArchivo, int seed, int n_pixels, const unsigned short int *datos)
+{
+    /*
+     * @brief Escribe un archivo de enmascaramiento en el formato binario.
+     *
+     * @param nombreArchivo Ruta del archivo M<i>.bin a crear.
+     * @param seed Semilla del enmascaramiento.
+     * @param n_pixels Cantidad de pixeles enmascarados.
+     * @param datos Sumas R, G, B (n_pixels*3 valores).
+     *
+     * @return true si el archivo se escribio correctamente; false en caso contrario.
+     */
+
+    size_t cantidad = (size_t)n_pixels * 3;
+    unsigned short int *valoresLE = new unsigned short int[cantidad];
+    for (size_t k = 0; k < cantidad; k++)
+    {
+        valoresLE[k] = aLittleEndian(datos[k]);
+    }
+
+    cabeceraMascaraBinaria cabecera;
+    memcpy(cabecera.firma, FIRMA, 4);
+    cabecera.version = aLittleEndian(VERSION);
+    cabecera.seed = aLittleEndian((unsigned int)seed);
+    cabecera.n_pixels = aLittleEndian((unsigned int)n_pixels);
+    cabecera.suma = aLittleEndian(calcularSuma((const unsigned char *)valoresLE, cantidad * sizeof(unsigned short int)));
+    cabecera.reservado = 0;
+
+    QFile salida(nombreArchivo);
+    bool correcto = salida.open(QIODevice::WriteOnly)
+                    && salida.write((const char *)&cabecera, sizeof(cabecera)) == (qint64)sizeof(cabecera)
+                    && salida.write((const char *)valoresLE, cantidad * sizeof(unsigned short int)) == (qint64)(cantidad * sizeof(unsigned short int));
+    salida.close();
+
+    delete[] valoresLE;
+    return correcto;
+}
+
+bool mascaraBinaria::convertir(const QString &archivoTexto, const QString &archivoBinario)
+{
+    /*
+     * @brief Convierte un archivo M<i>.txt (formato de loadSeedMasking) al formato binario.
+     *
+     * @return true si la conversion fue exitosa; false si el texto no pudo leerse o el binario escribirse.
+     */
+
+    bmp bmp;
+    int seed = 0;
+    int n_pixels = 0;
+    unsigned short int *datos = bmp.loadSeedMasking(archivoTexto.toStdString().c_str(), seed, n_pixels);
+    if (datos == nullptr)
+    {
+        return false;
+    }
+
+    bool correcto = escribir(archivoBinario, seed, n_pixels, datos);
+    delete[] datos;
+    return correcto;
+}
+
+unsigned int mascaraBinaria::calcularSuma(const unsigned char *datos, size_t totalBytes)
+{
+    // FNV-1a de 32 bits
+    unsigned int suma = 2166136261u;
+    for (size_t i = 0; i < totalBytes; i++)
+    {
+        suma = (suma ^ datos[i]) * 16777619u;
+    }
+    return suma;
+}
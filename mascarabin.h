@@ -0,0 +1,56 @@
+#ifndef MASCARABIN_H
+#define MASCARABIN_H
+
+#include <QFile>
+#include <QString>
+
+// Formato binario de los archivos de enmascaramiento (M<i>.bin), en little endian:
+//
+//   bytes  0..3   firma "DSM1"
+//   bytes  4..7   version (1)
+//   bytes  8..11  seed
+//   bytes 12..15  n_pixels
+//   bytes 16..19  suma de verificacion (FNV-1a de 32 bits sobre los datos)
+//   bytes 20..23  reservado (0)
+//   bytes 24..    n_pixels*3 sumas R, G, B de 16 bits
+//
+// Los datos quedan alineados a 8 bytes, por lo que pueden usarse directamente desde el mapeo del archivo.
+struct cabeceraMascaraBinaria
+{
+    char firma[4];
+    unsigned int version;
+    unsigned int seed;
+    unsigned int n_pixels;
+    unsigned int suma;
+    unsigned int reservado;
+};
+
+class mascaraBinaria
+{
+public:
+    mascaraBinaria();
+    ~mascaraBinaria();
+
+    bool abrir(const QString &nombreArchivo, bool verificarSuma = true);
+    void cerrar();
+
+    const unsigned short int *datos() const;
+    int seed() const;
+    int n_pixels() const;
+
+    static bool escribir(const QString &nombreArchivo, int seed, int n_pixels, const unsigned short int *datos);
+    static bool convertir(const QString &archivoTexto, const QString &archivoBinario);
+    static unsigned int calcularSuma(const unsigned char *datos, size_t totalBytes);
+
+private:
+    mascaraBinaria(const mascaraBinaria &) = delete;
+    mascaraBinaria &operator=(const mascaraBinaria &) = delete;
+
+    QFile archivo;
+    const unsigned short int *valores;
+    unsigned short int *copia; // Solo se usa en maquinas big endian
+    int semilla;
+    int pixeles;
+};
+
+#endif // MASCARABIN_H
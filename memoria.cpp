@@ -0,0 +1,169 @@
+#include "memoria.h"
+#include "bmp.h"
+#include "codecbmp.h"
+#include "identificacion.h"
+#include "mascarabin.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QtGlobal>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+size_t memoriaPico()
+{
+    /*
+     * @brief Retorna el pico de memoria residente del proceso (getrusage en Unix, GetProcessMemoryInfo en Windows).
+     */
+
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS contadores;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &contadores, sizeof(contadores)))
+    {
+        return contadores.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined(Q_OS_UNIX)
+    struct rusage uso;
+    if (getrusage(RUSAGE_SELF, &uso) != 0)
+    {
+        return 0;
+    }
+#if defined(Q_OS_MACOS)
+    return (size_t)uso.ru_maxrss; // En bytes
+#else
+    return (size_t)uso.ru_maxrss * 1024; // En kilobytes
+#endif
+#else
+    return 0;
+#endif
+}
+
+size_t megabytes(size_t bytes)
+{
+    return (bytes + (1 << 20) - 1) >> 20;
+}
+
+bool estimarMemoria(const QString &rutaDirectorio, necesidadMemoria &necesidad)
+{
+    /*
+     * @brief Estima la memoria que reservara la reconstruccion del caso de 'rutaDirectorio'.
+     *
+     * De las imagenes solo se leen las cabeceras. De cada archivo M<i>.bin se lee la cabecera (su cantidad
+     * de pixeles es exacta); de cada M<i>.txt se usa el tamaño del archivo, que es lo que reserva
+     * loadSeedMasking para los datos y una cota de la cantidad de pixeles (cada linea ocupa al menos 6 bytes).
+     *
+     * @return true si todos los archivos pudieron abrirse; false en caso contrario.
+     */
+
+    bmp bmp;
+    imagenBMP archivoID;
+    if (!archivoID.abrir(rutaDirectorio + "/I_D.bmp"))
+    {
+        return false;
+    }
+    necesidad.imagen = archivoID.totalBytes();
+    necesidad.fila = (size_t)archivoID.ancho() * 3;
+
+    size_t datos = 0;
+    size_t ventanaMaxima = 0;
+    int n_texto = bmp.contarArchivosMascara(rutaDirectorio);
+    int n_binario = bmp.contarArchivosMascara(rutaDirectorio, "M*.bin");
+    int n_etapas = n_texto > n_binario ? n_texto : n_binario;
+    for (int i = 0; i < n_etapas; i++)
+    {
+        QString base = rutaDirectorio + "/M" + QString::number(i);
+        size_t bytesDatos = 0;
+        size_t bytesVentana = 0;
+        mascaraBinaria binario;
+        if (QFile::exists(base + ".bin"))
+        {
+            if (!binario.abrir(base + ".bin", false))
+            {
+                return false;
+            }
+            bytesVentana = (size_t)binario.n_pixels() * 3;
+            bytesDatos = bytesVentana * sizeof(unsigned short int);
+        }
+        else
+        {
+            QFileInfo texto(base + ".txt");
+            if (!texto.exists())
+            {
+                return false;
+            }
+            bytesDatos = texto.size();
+            bytesVentana = texto.size() / 6 * 3;
+        }
+
+        // Los datos, la ventana esperada y la muestra de la etapa
+        datos += bytesDatos + bytesVentana + 64;
+        ventanaMaxima = bytesVentana > ventanaMaxima ? bytesVentana : ventanaMaxima;
+    }
+
+    // El prefijo de M, las dos ventanas de trabajo y las tablas del motor de identificacion
+    necesidad.fija = datos + 3 * ventanaMaxima + 256 * 256 * sizeof(mascaraCandidatos);
+    return true;
+}
+
+limiteMemoria::limiteMemoria(size_t bytes)
+    : maximo(bytes), usados(0)
+{
+}
+
+size_t limiteMemoria::total() const
+{
+    return maximo;
+}
+
+bool limiteMemoria::reservar(size_t bytes)
+{
+    /*
+     * @brief Reserva 'bytes' del limite, esperando si hace falta a que otros casos liberen los suyos.
+     *
+     * @return true si se reservo; false si 'bytes' supera el limite completo (la reserva nunca podria cumplirse).
+     */
+
+    if (bytes > maximo)
+    {
+        return false;
+    }
+    unique_lock<mutex> bloqueo(candado);
+    liberada.wait(bloqueo, [&]() { return usados + bytes <= maximo; });
+    usados += bytes;
+    return true;
+}
+
+void limiteMemoria::liberar(size_t bytes)
+{
+    {
+        lock_guard<mutex> bloqueo(candado);
+        usados -= bytes;
+    }
+    liberada.notify_all();
+}
+
+reservaMemoria::reservaMemoria(limiteMemoria *l, size_t b)
+    : limite(l), bytes(b), correcta(l == nullptr || l->reservar(b))
+{
+}
+
+reservaMemoria::~reservaMemoria()
+{
+    if (limite != nullptr && correcta)
+    {
+        limite->liberar(bytes);
+    }
+}
+
+bool reservaMemoria::valida() const
+{
+    return correcta;
+}
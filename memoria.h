@@ -0,0 +1,69 @@
+#ifndef MEMORIA_H
+#define MEMORIA_H
+
+#include <QString>
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// Memoria maxima residente (pico de RSS) del proceso hasta el momento, en bytes; 0 si el sistema no la informa
+size_t memoriaPico();
+
+// Cantidad de megabytes (redondeada hacia arriba) de 'bytes', para los mensajes
+size_t megabytes(size_t bytes);
+
+// Memoria (en bytes) que reserva la reconstruccion de un caso, estimada solo con las cabeceras de sus
+// archivos. No incluye los mapeos de los archivos, cuyas paginas el sistema puede descartar.
+struct necesidadMemoria
+{
+    size_t imagen; // Una imagen completa (I_D o I_M)
+    size_t fila;   // Una fila de I_D
+    size_t fija;   // Datos de enmascaramiento, ventanas esperadas, prefijo de M, ventanas de trabajo y tablas
+};
+
+bool estimarMemoria(const QString &rutaDirectorio, necesidadMemoria &necesidad);
+
+// Limite de memoria compartido por todas las reconstrucciones del proceso. Cada caso reserva lo que
+// necesita antes de cargar nada; si no hay lugar espera a que otro caso libere su parte, y si no
+// entraria ni con el limite completo falla de inmediato. La espera nunca se hace en un hilo del pool
+// (que podria ser el que tiene que terminar el caso que libera): los modos por lotes y servicio admiten
+// los casos antes de reconstruirlos (ver imagenesAdmitidas).
+class limiteMemoria
+{
+public:
+    explicit limiteMemoria(size_t bytes);
+
+    size_t total() const;
+    bool reservar(size_t bytes);
+    void liberar(size_t bytes);
+
+private:
+    limiteMemoria(const limiteMemoria &) = delete;
+    limiteMemoria &operator=(const limiteMemoria &) = delete;
+
+    std::mutex candado;
+    std::condition_variable liberada;
+    size_t maximo;
+    size_t usados;
+};
+
+// Reserva de un limiteMemoria que se libera al destruirse
+class reservaMemoria
+{
+public:
+    reservaMemoria(limiteMemoria *limite, size_t bytes);
+    ~reservaMemoria();
+
+    bool valida() const;
+
+private:
+    reservaMemoria(const reservaMemoria &) = delete;
+    reservaMemoria &operator=(const reservaMemoria &) = delete;
+
+    limiteMemoria *limite;
+    size_t bytes;
+    bool correcta;
+};
+
+#endif // MEMORIA_H
@@ -0,0 +1,401 @@
+#include "operaciones.h"
+#include "identificacion.h"
+#include "kernels.h"
+#include "traza.h"
+
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+namespace
+{
+// Cada operacion se describe una sola vez como un tipo con la transformacion de un byte para una
+// cantidad de bits fija (B). A partir de ese tipo se generan, por plantillas, los kernels de todas las
+// combinaciones (operacion, bits), de modo que cada kernel queda sin ramas dentro del ciclo de bytes.
+template <unsigned B>
+constexpr unsigned char rotarByteIzquierda(unsigned char x)
+{
+    return (unsigned char)((x << (B % 8)) | (x >> (8 - B % 8)));
+}
+
+template <unsigned B>
+constexpr unsigned char rotarByteDerecha(unsigned char x)
+{
+    return (unsigned char)((x >> (B % 8)) | (x << (8 - B % 8)));
+}
+
+struct opXOR
+{
+    static constexpr const char *clave = "xor";
+    static constexpr const char *claveDirecta = "xor";
+    static constexpr const char *descripcion = "un XOR";
+    static constexpr bool usaBits = false, posicional = true, sinPerdida = true, simd = true;
+    static constexpr int ronda = 0;
+    template <unsigned B> static constexpr unsigned char inversa(unsigned char x, unsigned char m) { return x ^ m; }
+    template <unsigned B> static constexpr unsigned char directa(unsigned char x, unsigned char m) { return x ^ m; }
+    template <unsigned B> static void inversaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *m, size_t n) { kernels::XOR(d, o, m, n); }
+    template <unsigned B> static void directaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *m, size_t n) { kernels::XOR(d, o, m, n); }
+};
+
+// En la reconstruccion se aplica un desplazamiento a la izquierda y se reporta como tal; la
+// transformacion original es un desplazamiento a la derecha, y asi se llama en --cadena (claveDirecta)
+struct opDesplazamientoIzquierda
+{
+    static constexpr const char *clave = "despIzq";
+    static constexpr const char *claveDirecta = "despDer";
+    static constexpr const char *descripcion = "un desplazamiento a la izquierda";
+    static constexpr bool usaBits = true, posicional = false, sinPerdida = false, simd = true;
+    static constexpr int ronda = 0;
+    template <unsigned B> static constexpr unsigned char inversa(unsigned char x, unsigned char) { return (unsigned char)((x << B) & 0xFF); }
+    template <unsigned B> static constexpr unsigned char directa(unsigned char x, unsigned char) { return (unsigned char)(x >> B); }
+    template <unsigned B> static void inversaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *, size_t n) { kernels::desplazamientoIzquierda(d, o, B, n); }
+    template <unsigned B> static void directaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *, size_t n) { kernels::desplazamientoDerecha(d, o, B, n); }
+};
+
+struct opDesplazamientoDerecha
+{
+    static constexpr const char *clave = "despDer";
+    static constexpr const char *claveDirecta = "despIzq";
+    static constexpr const char *descripcion = "un desplazamiento a la derecha";
+    static constexpr bool usaBits = true, posicional = false, sinPerdida = false, simd = true;
+    static constexpr int ronda = 0;
+    template <unsigned B> static constexpr unsigned char inversa(unsigned char x, unsigned char) { return (unsigned char)(x >> B); }
+    template <unsigned B> static constexpr unsigned char directa(unsigned char x, unsigned char) { return (unsigned char)((x << B) & 0xFF); }
+    template <unsigned B> static void inversaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *, size_t n) { kernels::desplazamientoDerecha(d, o, B, n); }
+    template <unsigned B> static void directaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *, size_t n) { kernels::desplazamientoIzquierda(d, o, B, n); }
+};
+
+// Una rotacion a la izquierda se deshace rotando a la derecha
+struct opRotacionIzquierda
+{
+    static constexpr const char *clave = "rotIzq";
+    static constexpr const char *claveDirecta = "rotIzq";
+    static constexpr const char *descripcion = "una rotacion a la izquierda";
+    static constexpr bool usaBits = true, posicional = false, sinPerdida = true, simd = true;
+    static constexpr int ronda = 0;
+    template <unsigned B> static constexpr unsigned char inversa(unsigned char x, unsigned char) { return rotarByteDerecha<B>(x); }
+    template <unsigned B> static constexpr unsigned char directa(unsigned char x, unsigned char) { return rotarByteIzquierda<B>(x); }
+    template <unsigned B> static void inversaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *, size_t n) { kernels::rotarDerecha(d, o, B, n); }
+    template <unsigned B> static void directaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *, size_t n) { kernels::rotarIzquierda(d, o, B, n); }
+};
+
+struct opRotacionDerecha
+{
+    static constexpr const char *clave = "rotDer";
+    static constexpr const char *claveDirecta = "rotDer";
+    static constexpr const char *descripcion = "una rotacion a la derecha";
+    static constexpr bool usaBits = true, posicional = false, sinPerdida = true, simd = true;
+    static constexpr int ronda = 0;
+    template <unsigned B> static constexpr unsigned char inversa(unsigned char x, unsigned char) { return rotarByteIzquierda<B>(x); }
+    template <unsigned B> static constexpr unsigned char directa(unsigned char x, unsigned char) { return rotarByteDerecha<B>(x); }
+    template <unsigned B> static void inversaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *, size_t n) { kernels::rotarIzquierda(d, o, B, n); }
+    template <unsigned B> static void directaSIMD(unsigned char *d, const unsigned char *o, const unsigned char *, size_t n) { kernels::rotarDerecha(d, o, B, n); }
+};
+
+// Operaciones adicionales. Se prueban despues de todas las anteriores para no cambiar el resultado
+// de los casos que ya se identificaban (por ejemplo, el intercambio de nibbles equivale a rotar 4 bits).
+struct opIntercambioNibbles
+{
+    static constexpr const char *clave = "nibbles";
+    static constexpr const char *claveDirecta = "nibbles";
+    static constexpr const char *descripcion = "un intercambio de nibbles";
+    static constexpr bool usaBits = false, posicional = false, sinPerdida = true, simd = false;
+    static constexpr int ronda = MAX_BITS_OPERACION + 1;
+    template <unsigned B> static constexpr unsigned char inversa(unsigned char x, unsigned char) { return (unsigned char)((x << 4) | (x >> 4)); }
+    template <unsigned B> static constexpr unsigned char directa(unsigned char x, unsigned char) { return (unsigned char)((x << 4) | (x >> 4)); }
+};
+
+struct opInversionBits
+{
+    static constexpr const char *clave = "reversa";
+    static constexpr const char *claveDirecta = "reversa";
+    static constexpr const char *descripcion = "una inversion del orden de los bits";
+    static constexpr bool usaBits = false, posicional = false, sinPerdida = true, simd = false;
+    static constexpr int ronda = MAX_BITS_OPERACION + 1;
+    static constexpr unsigned char reversa(unsigned char x)
+    {
+        x = (unsigned char)(((x & 0xF0) >> 4) | ((x & 0x0F) << 4));
+        x = (unsigned char)(((x & 0xCC) >> 2) | ((x & 0x33) << 2));
+        return (unsigned char)(((x & 0xAA) >> 1) | ((x & 0x55) << 1));
+    }
+    template <unsigned B> static constexpr unsigned char inversa(unsigned char x, unsigned char) { return reversa(x); }
+    template <unsigned B> static constexpr unsigned char directa(unsigned char x, unsigned char) { return reversa(x); }
+};
+
+// Suma y resta modulo 256 con el byte de I_M de la misma posicion
+struct opSuma
+{
+    static constexpr const char *clave = "suma";
+    static constexpr const char *claveDirecta = "suma";
+    static constexpr const char *descripcion = "una suma modulo 256 con I_M";
+    static constexpr bool usaBits = false, posicional = true, sinPerdida = true, simd = false;
+    static constexpr int ronda = MAX_BITS_OPERACION + 1;
+    template <unsigned B> static constexpr unsigned char inversa(unsigned char x, unsigned char m) { return (unsigned char)(x - m); }
+    template <unsigned B> static constexpr unsigned char directa(unsigned char x, unsigned char m) { return (unsigned char)(x + m); }
+};
+
+struct opResta
+{
+    static constexpr const char *clave = "resta";
+    static constexpr const char *claveDirecta = "resta";
+    static constexpr const char *descripcion = "una resta modulo 256 con I_M";
+    static constexpr bool usaBits = false, posicional = true, sinPerdida = true, simd = false;
+    static constexpr int ronda = MAX_BITS_OPERACION + 1;
+    template <unsigned B> static constexpr unsigned char inversa(unsigned char x, unsigned char m) { return (unsigned char)(x + m); }
+    template <unsigned B> static constexpr unsigned char directa(unsigned char x, unsigned char m) { return (unsigned char)(x - m); }
+};
+
+// Kernels genericos: la operacion y los bits son parametros de plantilla, asi que el compilador
+// genera (y puede vectorizar) un ciclo distinto para cada par. Las operaciones con version SIMD
+// despachada por CPU delegan en ella.
+template <class Op, unsigned B>
+void kernelInverso(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    if constexpr (Op::simd)
+    {
+        Op::template inversaSIMD<B>(destino, origen, IM, totalBytes);
+    }
+    else if constexpr (Op::posicional)
+    {
+        for (size_t i = 0; i < totalBytes; i++)
+            destino[i] = Op::template inversa<B>(origen[i], IM[i]);
+    }
+    else
+    {
+        for (size_t i = 0; i < totalBytes; i++)
+            destino[i] = Op::template inversa<B>(origen[i], 0);
+    }
+}
+
+template <class Op, unsigned B>
+void kernelDirecto(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    if constexpr (Op::simd)
+    {
+        Op::template directaSIMD<B>(destino, origen, IM, totalBytes);
+    }
+    else if constexpr (Op::posicional)
+    {
+        for (size_t i = 0; i < totalBytes; i++)
+            destino[i] = Op::template directa<B>(origen[i], IM[i]);
+    }
+    else
+    {
+        for (size_t i = 0; i < totalBytes; i++)
+            destino[i] = Op::template directa<B>(origen[i], 0);
+    }
+}
+
+template <class Op, unsigned B>
+unsigned char byteInverso(unsigned char x, unsigned char m)
+{
+    return Op::template inversa<B>(x, m);
+}
+
+template <class Op, unsigned B>
+unsigned char byteDirecto(unsigned char x, unsigned char m)
+{
+    return Op::template directa<B>(x, m);
+}
+
+template <class Op, size_t... B>
+constexpr descriptorOperacion describir(index_sequence<B...>)
+{
+    return {Op::clave, Op::claveDirecta, Op::descripcion, Op::usaBits, Op::posicional, Op::sinPerdida, Op::ronda,
+            {&kernelInverso<Op, B>...}, {&kernelDirecto<Op, B>...}, {&byteInverso<Op, B>...}, {&byteDirecto<Op, B>...}};
+}
+
+template <class Op>
+constexpr descriptorOperacion describir()
+{
+    return describir<Op>(make_index_sequence<MAX_BITS_OPERACION + 1>());
+}
+
+// Registro de operaciones. Para agregar una operacion basta con describirla arriba y listarla aqui.
+constexpr descriptorOperacion registro[] = {
+    describir<opXOR>(),
+    describir<opDesplazamientoIzquierda>(),
+    describir<opDesplazamientoDerecha>(),
+    describir<opRotacionIzquierda>(),
+    describir<opRotacionDerecha>(),
+    describir<opIntercambioNibbles>(),
+    describir<opInversionBits>(),
+    describir<opSuma>(),
+    describir<opResta>(),
+};
+
+const int n_operaciones = sizeof(registro) / sizeof(registro[0]);
+
+// Cantidad de candidatos que genera el registro (ver listaCandidatos)
+constexpr int contarCandidatos()
+{
+    int cantidad = 0;
+    for (int op = 0; op < n_operaciones; op++)
+    {
+        if (registro[op].usaBits)
+        {
+            cantidad += MAX_BITS_OPERACION;
+        }
+        else if (registro[op].ronda >= 0 && registro[op].ronda <= MAX_BITS_OPERACION + 1)
+        {
+            cantidad++;
+        }
+    }
+    return cantidad;
+}
+
+// El motor de identificacion representa los candidatos como bits de una mascaraCandidatos
+static_assert(contarCandidatos() <= MAX_CANDIDATOS_MOTOR, "Los candidatos del registro no caben en una mascaraCandidatos");
+
+// Orden de prueba de los candidatos: por rondas. En la ronda r se prueban las operaciones con bits
+// usando r bits (1..8) y las operaciones sin bits cuya ronda es r, en el orden del registro.
+struct listaCandidatos
+{
+    candidato elementos[n_operaciones * (MAX_BITS_OPERACION + 1)];
+    int cantidad;
+
+    listaCandidatos() : cantidad(0)
+    {
+        for (int ronda = 0; ronda <= MAX_BITS_OPERACION + 1; ronda++)
+        {
+            for (int op = 0; op < n_operaciones; op++)
+            {
+                const descriptorOperacion &d = registro[op];
+                bool usaRonda = d.usaBits ? (ronda >= 1 && ronda <= MAX_BITS_OPERACION) : d.ronda == ronda;
+                if (usaRonda)
+                {
+                    elementos[cantidad].operacion = op;
+                    elementos[cantidad].bits = d.usaBits ? ronda : 0;
+                    cantidad++;
+                }
+            }
+        }
+    }
+};
+
+const listaCandidatos &candidatos()
+{
+    static const listaCandidatos lista;
+    return lista;
+}
+}
+
+int cantidadOperaciones()
+{
+    return n_operaciones;
+}
+
+const descriptorOperacion &obtenerOperacion(int i)
+{
+    return registro[i];
+}
+
+int buscarOperacion(const char *clave)
+{
+    /*
+     * @brief Busca una operacion del registro por su nombre corto.
+     *
+     * @return Indice de la operacion en el registro, o -1 si no existe.
+     */
+
+    for (int i = 0; i < n_operaciones; i++)
+    {
+        if (strcmp(registro[i].clave, clave) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int buscarOperacionDirecta(const char *clave)
+{
+    /*
+     * @brief Busca una operacion del registro por el nombre de su transformacion original (claveDirecta).
+     *
+     * @return Indice de la operacion en el registro, o -1 si no existe.
+     */
+
+    for (int i = 0; i < n_operaciones; i++)
+    {
+        if (strcmp(registro[i].claveDirecta, clave) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int cantidadCandidatos()
+{
+    return candidatos().cantidad;
+}
+
+const candidato &obtenerCandidato(int i)
+{
+    return candidatos().elementos[i];
+}
+
+int buscarCandidato(int operacion, unsigned bits)
+{
+    /*
+     * @brief Busca el candidato de una operacion con una cantidad de bits (0 para las que no usan bits).
+     *
+     * @return Indice del candidato (ver obtenerCandidato), o -1 si no existe.
+     */
+
+    for (int c = 0; operacion >= 0 && c < cantidadCandidatos(); c++)
+    {
+        if (obtenerCandidato(c).operacion == operacion && obtenerCandidato(c).bits == bits)
+        {
+            return c;
+        }
+    }
+    return -1;
+}
+
+void aplicarCandidato(const candidato &c, unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    /*
+     * @brief Aplica la operacion inversa de un candidato (la que se usa para reconstruir).
+     *
+     * @param c Candidato (operacion y bits) a aplicar.
+     * @param destino Arreglo donde se escribe el resultado. Puede ser el mismo 'origen'.
+     * @param origen Arreglo con los valores RGB a transformar.
+     * @param IM Valores de I_M alineados con 'origen' (solo los leen las operaciones posicionales).
+     * @param totalBytes Cantidad de bytes a transformar.
+     */
+
+    TRAZA_ALCANCE("aplicarCandidato");
+    TRAZA_SUMAR(traza::BYTES_TRANSFORMADOS, totalBytes);
+    registro[c.operacion].inversa[c.bits](destino, origen, IM, totalBytes);
+}
+
+void aplicarDirecta(const candidato &c, unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes)
+{
+    /*
+     * @brief Aplica la transformacion original de un candidato (la que produce la distorsion).
+     *
+     * Los parametros son los mismos de aplicarCandidato.
+     */
+
+    TRAZA_ALCANCE("aplicarDirecta");
+    TRAZA_SUMAR(traza::BYTES_TRANSFORMADOS, totalBytes);
+    registro[c.operacion].directa[c.bits](destino, origen, IM, totalBytes);
+}
+
+string describirCandidato(const candidato &c)
+{
+    /*
+     * @brief Genera el texto con el que se reporta un candidato, por ejemplo "una rotacion a la izquierda de 3 bits".
+     */
+
+    const descriptorOperacion &d = registro[c.operacion];
+    string texto = d.descripcion;
+    if (d.usaBits)
+    {
+        texto += " de " + to_string(c.bits) + " bits";
+    }
+    return texto;
+}
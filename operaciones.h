@@ -0,0 +1,50 @@
+#ifndef OPERACIONES_H
+#define OPERACIONES_H
+
+#include <cstddef>
+#include <string>
+
+// Kernel de una operacion para una cantidad fija de bits: destino[i] = f(origen[i], IM[i]).
+// 'IM' solo lo leen las operaciones posicionales (XOR, suma y resta con I_M).
+typedef void (*kernelOperacion)(unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes);
+
+// Version escalar de una operacion para un solo byte (usada para construir tablas)
+typedef unsigned char (*funcionByte)(unsigned char x, unsigned char m);
+
+const int MAX_BITS_OPERACION = 8;
+
+struct descriptorOperacion
+{
+    const char *clave;                             // Nombre corto de la operacion que se aplica en la reconstruccion
+    const char *claveDirecta;                      // Nombre corto de la transformacion original (--cadena)
+    const char *descripcion;                       // Descripcion de la transformacion detectada (para los mensajes)
+    bool usaBits;                                  // true si la operacion se prueba para 1..8 bits
+    bool posicional;                               // true si la operacion usa el byte de I_M de la misma posicion
+    bool sinPerdida;                               // true si 'inversa' deshace exactamente a 'directa'
+    int ronda;                                     // Ronda en la que se prueba una operacion sin bits (ver candidatos)
+    kernelOperacion inversa[MAX_BITS_OPERACION + 1]; // Operacion que se aplica en la reconstruccion, por bits
+    kernelOperacion directa[MAX_BITS_OPERACION + 1]; // Transformacion original que produce la distorsion, por bits
+    funcionByte byteInversa[MAX_BITS_OPERACION + 1];
+    funcionByte byteDirecta[MAX_BITS_OPERACION + 1];
+};
+
+// Un candidato es una operacion del registro junto con la cantidad de bits con la que se prueba
+struct candidato
+{
+    int operacion;
+    unsigned short int bits;
+};
+
+int cantidadOperaciones();
+const descriptorOperacion &obtenerOperacion(int i);
+int buscarOperacion(const char *clave);
+int buscarOperacionDirecta(const char *clave);
+
+int cantidadCandidatos();
+const candidato &obtenerCandidato(int i);
+int buscarCandidato(int operacion, unsigned bits);
+void aplicarCandidato(const candidato &c, unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes);
+void aplicarDirecta(const candidato &c, unsigned char *destino, const unsigned char *origen, const unsigned char *IM, size_t totalBytes);
+std::string describirCandidato(const candidato &c);
+
+#endif // OPERACIONES_H
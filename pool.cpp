@@ -0,0 +1,259 @@
+#include "pool.h"
+
+using namespace std;
+
+namespace
+{
+// Pool y cola del hilo de trabajo actual (nullptr y -1 fuera de los hilos de un pool)
+thread_local const poolHilos *poolDelHilo = nullptr;
+thread_local int colaDelHilo = -1;
+
+// Cantidad de tareas que el hilo actual esta ejecutando una dentro de otra (ver esperar)
+thread_local int profundidad = 0;
+}
+
+grupoTareas::grupoTareas() : pendientes(0)
+{
+}
+
+poolHilos::poolHilos(int n) : encoladas(0), encoladasExterna(0), detener(false)
+{
+    /*
+     * @brief Crea un pool con 'n' hilos de trabajo.
+     *
+     * @param n Cantidad de hilos. Si es 0 o negativo se usa la cantidad de nucleos de la maquina.
+     *
+     * @note El hilo que llama a esperar() tambien ejecuta tareas, por lo que un pool de 1 hilo
+     *       ya permite procesar dos tareas a la vez.
+     */
+
+    if (n <= 0)
+    {
+        n = thread::hardware_concurrency();
+    }
+    if (n <= 0)
+    {
+        n = 1;
+    }
+    for (int i = 0; i <= n; i++)
+    {
+        colas.emplace_back(new colaTareas);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        hilos.emplace_back(&poolHilos::trabajar, this, i);
+    }
+}
+
+poolHilos::~poolHilos()
+{
+    {
+        lock_guard<mutex> bloqueo(candado);
+        detener = true;
+    }
+    hayTrabajo.notify_all();
+    for (thread &h : hilos)
+    {
+        h.join();
+    }
+}
+
+void poolHilos::ejecutar(grupoTareas &grupo, function<void()> tarea)
+{
+    /*
+     * @brief Encola una tarea que pertenece a 'grupo'.
+     *
+     * Desde un hilo del pool la tarea va a la cola de ese hilo; desde cualquier otro hilo, a la cola externa.
+     * Si otro hilo la encola mientras ejecuta una tarea (por ejemplo, el hilo principal ayudando con un
+     * caso del modo por lotes), se marca como anidada y va al frente de la cola externa, para que se
+     * atienda antes que los trabajos completos que esperan en ella.
+     */
+
+    int indice = indiceDelHilo();
+    bool externa = indice < 0;
+    bool anidada = externa && profundidad > 0;
+    colaTareas &cola = externa ? *colas.back() : *colas[indice];
+
+    grupo.pendientes++;
+    {
+        lock_guard<mutex> bloqueo(cola.candado);
+        if (anidada)
+        {
+            cola.tareas.push_front({&grupo, move(tarea), true});
+        }
+        else
+        {
+            cola.tareas.push_back({&grupo, move(tarea), false});
+        }
+    }
+    if (externa && !anidada)
+    {
+        encoladasExterna++;
+    }
+    encoladas++;
+    {
+        // Se toma el mutex para que quien esta por dormir no pierda la notificacion
+        lock_guard<mutex> bloqueo(candado);
+    }
+    hayTrabajo.notify_one();
+    tareaTerminada.notify_all(); // Despierta tambien a quien espera un grupo, para que ayude
+}
+
+void poolHilos::esperar(grupoTareas &grupo)
+{
+    /*
+     * @brief Espera a que terminen todas las tareas de 'grupo'.
+     *
+     * Mientras espera, el hilo que llama ejecuta tareas de las colas, de modo que es seguro esperar
+     * un grupo desde dentro de otra tarea del mismo pool. Dentro de una tarea solo se toman de la cola
+     * externa las tareas anidadas: las demas son trabajos completos (por ejemplo, otro caso del modo por
+     * lotes) y ejecutarlos anidados solo retrasaria el grupo que se espera.
+     */
+
+    while (grupo.pendientes.load() > 0)
+    {
+        bool incluirExterna = profundidad == 0;
+        tareaPendiente tarea;
+        if (tomarTarea(tarea, incluirExterna))
+        {
+            correrTarea(tarea);
+            continue;
+        }
+
+        unique_lock<mutex> bloqueo(candado);
+        tareaTerminada.wait(bloqueo, [&] {
+            int disponibles = incluirExterna ? encoladas.load() : encoladas.load() - encoladasExterna.load();
+            return grupo.pendientes.load() == 0 || disponibles > 0;
+        });
+    }
+}
+
+int poolHilos::cantidadHilos() const
+{
+    return (int)hilos.size();
+}
+
+int poolHilos::indiceDelHilo() const
+{
+    return poolDelHilo == this ? colaDelHilo : -1;
+}
+
+bool poolHilos::tomarDe(int indice, bool propia, tareaPendiente &tarea)
+{
+    /*
+     * @brief Saca una tarea de la cola 'indice'.
+     *
+     * Un hilo toma de su propia cola por el frente, para que sus tareas (los casos del modo por lotes, los
+     * bloques de una imagen, las ramas de la busqueda) corran en el orden en que se encolaron; el robo
+     * se hace por el final.
+     */
+
+    colaTareas &cola = *colas[indice];
+    lock_guard<mutex> bloqueo(cola.candado);
+    if (cola.tareas.empty())
+    {
+        return false;
+    }
+    if (propia)
+    {
+        tarea = move(cola.tareas.front());
+        cola.tareas.pop_front();
+    }
+    else
+    {
+        tarea = move(cola.tareas.back());
+        cola.tareas.pop_back();
+    }
+    return true;
+}
+
+bool poolHilos::tomarExterna(bool soloAnidadas, tareaPendiente &tarea)
+{
+    /*
+     * @brief Saca la tarea del frente de la cola externa; con 'soloAnidadas', solo si es anidada.
+     */
+
+    colaTareas &cola = *colas.back();
+    lock_guard<mutex> bloqueo(cola.candado);
+    if (cola.tareas.empty() || (soloAnidadas && !cola.tareas.front().anidada))
+    {
+        return false;
+    }
+    tarea = move(cola.tareas.front());
+    cola.tareas.pop_front();
+    if (!tarea.anidada)
+    {
+        encoladasExterna--;
+    }
+    return true;
+}
+
+bool poolHilos::tomarTarea(tareaPendiente &tarea, bool incluirExterna)
+{
+    /*
+     * @brief Busca una tarea: primero en la cola propia, luego en la externa y por ultimo en las de los demas hilos.
+     */
+
+    if (encoladas.load() == 0)
+    {
+        return false;
+    }
+
+    int propia = indiceDelHilo();
+    int n = (int)hilos.size();
+    if (propia >= 0 && tomarDe(propia, true, tarea))
+    {
+        encoladas--;
+        return true;
+    }
+    if (tomarExterna(!incluirExterna, tarea))
+    {
+        encoladas--;
+        return true;
+    }
+    for (int k = 1; k <= n; k++)
+    {
+        int victima = (propia + k + n) % n;
+        if (victima != propia && tomarDe(victima, false, tarea))
+        {
+            encoladas--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void poolHilos::correrTarea(tareaPendiente &tarea)
+{
+    profundidad++;
+    tarea.funcion();
+    profundidad--;
+    tarea.grupo->pendientes--;
+    {
+        // Se toma el mutex para que quien espera no pierda la notificacion
+        lock_guard<mutex> bloqueo(candado);
+    }
+    tareaTerminada.notify_all();
+}
+
+void poolHilos::trabajar(int indice)
+{
+    poolDelHilo = this;
+    colaDelHilo = indice;
+    while (true)
+    {
+        tareaPendiente tarea;
+        if (tomarTarea(tarea, true))
+        {
+            correrTarea(tarea);
+            continue;
+        }
+
+        unique_lock<mutex> bloqueo(candado);
+        hayTrabajo.wait(bloqueo, [&] { return detener || encoladas.load() > 0; });
+        if (detener && encoladas.load() == 0)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Conjunto de tareas que se espera como una unidad (por ejemplo, los bloques de una imagen o las ramas de una etapa de la busqueda)
+class grupoTareas
+{
+public:
+    grupoTareas();
+
+    std::atomic<int> pendientes;
+};
+
+// Pool de hilos con robo de trabajo: cada hilo tiene su propia cola, en la que quedan las tareas que
+// encolan sus tareas (por ejemplo, los bloques de un caso del modo por lotes), y cuando se queda sin
+// trabajo toma tareas de la cola externa o de las colas de los demas hilos.
+class poolHilos
+{
+public:
+    explicit poolHilos(int hilos = 0);
+    ~poolHilos();
+
+    void ejecutar(grupoTareas &grupo, std::function<void()> tarea);
+    void esperar(grupoTareas &grupo);
+    int cantidadHilos() const;
+
+private:
+    struct tareaPendiente
+    {
+        grupoTareas *grupo;
+        std::function<void()> funcion;
+        bool anidada; // Encolada en la cola externa desde dentro de otra tarea (ver ejecutar)
+    };
+
+    poolHilos(const poolHilos &) = delete;
+    poolHilos &operator=(const poolHilos &) = delete;
+
+    struct colaTareas
+    {
+        std::mutex candado;
+        std::deque<tareaPendiente> tareas;
+    };
+
+    bool tomarTarea(tareaPendiente &tarea, bool incluirExterna);
+    bool tomarDe(int indice, bool propia, tareaPendiente &tarea);
+    bool tomarExterna(bool soloAnidadas, tareaPendiente &tarea);
+    void correrTarea(tareaPendiente &tarea);
+    void trabajar(int indice);
+    int indiceDelHilo() const;
+
+    std::vector<std::thread> hilos;
+    std::vector<std::unique_ptr<colaTareas>> colas; // Una por hilo y, al final, la de las tareas encoladas desde fuera del pool
+    std::atomic<int> encoladas;                      // Tareas en todas las colas
+    std::atomic<int> encoladasExterna;               // Tareas no anidadas en la cola externa
+    std::mutex candado;                              // Solo protege las esperas en las variables de condicion
+    std::condition_variable hayTrabajo;
+    std::condition_variable tareaTerminada;
+    bool detener;
+};
+
+#endif // POOL_H
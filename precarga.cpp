@@ -0,0 +1,138 @@
+#include "precarga.h"
+
+using namespace std;
+
+precargador::precargador(int c)
+    : capacidad(c > 0 ? c : 1), siguiente(0), listas(0), detener(false)
+{
+}
+
+precargador::~precargador()
+{
+    /*
+     * @brief Detiene el hilo. Las cargas que todavia no habia empezado no se ejecutan.
+     */
+
+    {
+        lock_guard<mutex> bloqueo(candado);
+        detener = true;
+    }
+    cambio.notify_all();
+    if (hilo.joinable())
+    {
+        hilo.join();
+    }
+}
+
+int precargador::agregar(function<void()> funcion)
+{
+    /*
+     * @brief Agrega una carga al final de la serie (el hilo se crea con la primera).
+     *
+     * @return El indice de la carga, con el que se reclama o se descarta.
+     */
+
+    lock_guard<mutex> bloqueo(candado);
+    cargas.push_back({move(funcion), PENDIENTE, false});
+    if (!hilo.joinable())
+    {
+        hilo = thread(&precargador::trabajar, this);
+    }
+    cambio.notify_all();
+    return (int)cargas.size() - 1;
+}
+
+void precargador::reclamar(int indice)
+{
+    /*
+     * @brief Asegura que la carga 'indice' termino, para usar su resultado.
+     *
+     * Si el hilo ya la termino se toma tal cual; si la esta ejecutando se espera a que termine; y si
+     * todavia no la empezo, la ejecuta el hilo que la reclama (el hilo de precarga la saltea).
+     */
+
+    unique_lock<mutex> bloqueo(candado);
+    carga &c = cargas[indice];
+    if (c.estado == PENDIENTE)
+    {
+        c.estado = EN_CURSO;
+        function<void()> funcion = move(c.funcion);
+        bloqueo.unlock();
+        funcion();
+        bloqueo.lock();
+        cargas[indice].estado = CONSUMIDA;
+        return;
+    }
+    cambio.wait(bloqueo, [&]() { return cargas[indice].estado != EN_CURSO; });
+    if (cargas[indice].estado == LISTA)
+    {
+        cargas[indice].estado = CONSUMIDA;
+        listas--;
+        cambio.notify_all();
+    }
+}
+
+void precargador::descartar(int indice)
+{
+    /*
+     * @brief Indica que la carga 'indice' ya no hace falta: si no empezo, no se ejecuta; si esta en
+     *        curso, termina sin que nadie la espere.
+     */
+
+    lock_guard<mutex> bloqueo(candado);
+    carga &c = cargas[indice];
+    if (c.estado == PENDIENTE || c.estado == LISTA)
+    {
+        listas -= c.estado == LISTA ? 1 : 0;
+        c.estado = CONSUMIDA;
+        c.funcion = nullptr;
+        cambio.notify_all();
+    }
+    else if (c.estado == EN_CURSO && c.delHilo)
+    {
+        // El hilo la marcara como lista; al marcarla descartada no ocupa lugar en la capacidad
+        c.delHilo = false;
+    }
+}
+
+void precargador::trabajar()
+{
+    /*
+     * @brief Bucle del hilo de precarga: ejecuta las cargas en orden, sin superar 'capacidad' cargas sin consumir.
+     */
+
+    unique_lock<mutex> bloqueo(candado);
+    while (true)
+    {
+        cambio.wait(bloqueo, [&]() { return detener || (siguiente < (int)cargas.size() && listas < capacidad); });
+        if (detener)
+        {
+            return;
+        }
+
+        int indice = siguiente++;
+        if (cargas[indice].estado != PENDIENTE)
+        {
+            // La reclamo (o la descarto) el consumidor antes de que el hilo llegara a ella
+            continue;
+        }
+        cargas[indice].estado = EN_CURSO;
+        cargas[indice].delHilo = true;
+        function<void()> funcion = move(cargas[indice].funcion);
+        bloqueo.unlock();
+        funcion();
+        bloqueo.lock();
+
+        // Si se descarto mientras se ejecutaba, ya no ocupa lugar
+        if (cargas[indice].delHilo)
+        {
+            cargas[indice].estado = LISTA;
+            listas++;
+        }
+        else
+        {
+            cargas[indice].estado = CONSUMIDA;
+        }
+        cambio.notify_all();
+    }
+}
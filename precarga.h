@@ -0,0 +1,55 @@
+#ifndef PRECARGA_H
+#define PRECARGA_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Hilo que ejecuta por adelantado, en orden, una serie de cargas (por ejemplo, los archivos de
+// enmascaramiento de las proximas etapas) mientras el hilo que las consume trabaja en las anteriores.
+// Las cargas se consumen en el mismo orden con reclamar() o descartar(); el hilo nunca deja mas de
+// 'capacidad' cargas terminadas sin consumir, para no adelantarse demasiado (ni ocupar memoria de mas).
+class precargador
+{
+public:
+    explicit precargador(int capacidad);
+    ~precargador();
+
+    int agregar(std::function<void()> carga);
+    void reclamar(int indice);
+    void descartar(int indice);
+
+private:
+    enum estadoCarga
+    {
+        PENDIENTE,
+        EN_CURSO,
+        LISTA,
+        CONSUMIDA
+    };
+
+    struct carga
+    {
+        std::function<void()> funcion;
+        estadoCarga estado;
+        bool delHilo; // true si la ejecuta (o la ejecuto) el hilo de precarga
+    };
+
+    precargador(const precargador &) = delete;
+    precargador &operator=(const precargador &) = delete;
+
+    void trabajar();
+
+    std::vector<carga> cargas;
+    std::mutex candado;
+    std::condition_variable cambio;
+    std::thread hilo;
+    int capacidad;
+    int siguiente; // Proxima carga que considera el hilo
+    int listas;    // Cargas terminadas por el hilo que todavia no se consumieron
+    bool detener;
+};
+
+#endif // PRECARGA_H
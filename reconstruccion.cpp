@@ -0,0 +1,455 @@
+#include "reconstruccion.h"
+#include "bmp.h"
+#include "buffers.h"
+#include "busqueda.h"
+#include "cacheoperaciones.h"
+#include "cadena.h"
+#include "codecbmp.h"
+#include "contexto.h"
+#include "memoria.h"
+#include "operaciones.h"
+#include "pool.h"
+#include "traza.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+// Cantidad maxima de imagenes que se exportan, ademas de la principal, cuando la busqueda encuentra varias cadenas
+const int MAX_IMAGENES_ALTERNATIVAS = 8;
+
+// Clave de una etapa en la cache de operaciones: la huella de todo lo que recibe identificarVentana, es
+// decir la ventana de I_D ya transformada por las etapas anteriores, la de I_M y la ventana esperada
+// (que resume M y el archivo de enmascaramiento, sea .txt o .bin)
+unsigned long long claveEtapa(const unsigned char *ventana, const unsigned char *ventanaIM, const unsigned char *esperado, size_t bytes)
+{
+    unsigned long long clave = huellaBytes(ventana, bytes, bytes);
+    clave = combinarHuellas(clave, huellaBytes(ventanaIM, bytes));
+    return combinarHuellas(clave, huellaBytes(esperado, bytes));
+}
+
+// Carga los pixeles RGB de un BMP en un arreglo de 'buffers' (que queda en uso): con el lector nativo se
+// copian directamente a un arreglo del pool, que en modo servicio ya esta reservado por los casos anteriores
+unsigned char *cargarPixeles(const QString &ruta, int &ancho, int &alto, poolBuffers &buffers)
+{
+    TRAZA_ALCANCE("loadPixels");
+    imagenBMP imagen;
+    if (imagen.abrir(ruta))
+    {
+        ancho = imagen.ancho();
+        alto = imagen.alto();
+        unsigned char *pixeles = buffers.obtener(imagen.totalBytes());
+        TRAZA_SUMAR(traza::BYTES_LEIDOS, imagen.totalBytes());
+        if (!imagen.copiarRGB(pixeles))
+        {
+            buffers.devolver(pixeles);
+            return nullptr;
+        }
+        return pixeles;
+    }
+
+    // Formatos que el lector nativo no soporta (ver loadPixels)
+    bmp bmp;
+    unsigned char *pixeles = bmp.loadPixels(ruta, ancho, alto);
+    if (pixeles != nullptr)
+    {
+        buffers.adoptar(pixeles, (size_t)ancho * alto * 3);
+    }
+    return pixeles;
+}
+
+// Devuelve un arreglo a su pool al salir del alcance, por cualquier camino
+struct devolucionBuffer
+{
+    poolBuffers &buffers;
+    unsigned char *datos;
+
+    ~devolucionBuffer()
+    {
+        buffers.devolver(datos);
+    }
+};
+}
+
+int identificarVentana(const unsigned char *ventana, const unsigned char *ventanaIM, const contexto &ctx, int etapa, mascaraCandidatos *consistentes)
+{
+    /*
+     * @brief Identifica la operacion que deshace una etapa de la distorsion.
+     *
+     * La etapa se resuelve con el motor de identificacion (ver candidatosConsistentes): una sola pasada
+     * por la ventana entrega todos los candidatos consistentes y el ganador es el primero de ellos, el
+     * mismo que daria la prueba secuencial en orden.
+     *
+     * @param ventana Los n_pixels*3 bytes de la imagen a destransformar que empiezan en 'seed'.
+     * @param ventanaIM Los bytes de I_M de las mismas posiciones (solo los usan las operaciones posicionales).
+     * @param ctx Contexto con M y los datos de enmascaramiento ya cargados.
+     * @param etapa Indice del archivo 'M<etapa>.txt' con el que se verifica.
+     * @param consistentes Si no es nullptr, recibe todos los candidatos consistentes.
+     *
+     * @return Indice del candidato (ver obtenerCandidato) que verifica, o -1 si ninguno lo hace.
+     */
+
+    TRAZA_ALCANCE("identificarVentana");
+    const mascaraEtapa &datos = ctx.obtenerEtapa(etapa);
+    const size_t bytesVentana = (size_t)datos.n_pixels * 3;
+
+    // Si ningun byte puede producir los valores del archivo, ningun candidato verifica
+    if (consistentes != nullptr)
+    {
+        *consistentes = 0;
+    }
+    if (datos.esperado == nullptr)
+    {
+        return -1;
+    }
+
+    mascaraCandidatos encontrados = candidatosConsistentes(ventana, ventanaIM, datos.esperado, bytesVentana, datos.muestra, datos.n_muestra);
+    TRAZA_ETAPA(etapa, __builtin_popcountll(encontrados));
+    if (consistentes != nullptr)
+    {
+        *consistentes = encontrados;
+    }
+    for (int c = 0; c < cantidadCandidatos(); c++)
+    {
+        if (encontrados & (1ULL << c))
+        {
+            return c;
+        }
+    }
+    return -1;
+}
+
+int identificarVentanaCache(const unsigned char *ventana, const unsigned char *ventanaIM, const contexto &ctx, int etapa, mascaraCandidatos &consistentes,
+                            cacheOperaciones *operaciones)
+{
+    /*
+     * @brief Identifica una etapa con identificarVentana, consultando antes la cache de operaciones.
+     *
+     * La clave de la etapa es la huella de la ventana ya transformada, la de I_M y la ventana esperada
+     * (ver claveEtapa); si no esta en la cache, la etapa se identifica y, si algun candidato verifica, se guarda.
+     *
+     * @param consistentes Recibe todos los candidatos consistentes de la etapa (ver identificarVentana).
+     * @param operaciones Cache de operaciones, o nullptr para identificar siempre la ventana.
+     *
+     * @return Indice del candidato ganador, o -1 si ninguno verifica.
+     */
+
+    const mascaraEtapa &datos = ctx.obtenerEtapa(etapa);
+    const size_t bytesVentana = (size_t)datos.n_pixels * 3;
+    int ganador = -1;
+    consistentes = 0;
+    bool usarCache = operaciones != nullptr && datos.esperado != nullptr;
+    unsigned long long clave = usarCache ? claveEtapa(ventana, ventanaIM, datos.esperado, bytesVentana) : 0;
+    if (!usarCache || !operaciones->buscar(clave, ganador, consistentes))
+    {
+        ganador = identificarVentana(ventana, ventanaIM, ctx, etapa, &consistentes);
+        if (usarCache && ganador >= 0)
+        {
+            operaciones->guardar(clave, ganador, consistentes);
+        }
+    }
+    return ganador;
+}
+
+vector<int> identificarCadena(const lectorVentana &leer, const contexto &ctx, poolBuffers &buffers, vector<candidato> &cadena,
+                              vector<mascaraCandidatos> *consistentes, cacheOperaciones *operaciones)
+{
+    /*
+     * @brief Identifica todas las etapas usando solo las ventanas de enmascaramiento.
+     *
+     * Para cada etapa (de la ultima a la primera) se leen de I_D e I_M los bytes de su ventana, se les
+     * aplican las operaciones ya identificadas y se identifica la operacion de la etapa con
+     * identificarVentana. Como todas las operaciones actuan byte a byte, la ventana transformada es igual
+     * a la que se obtendria transformando la imagen completa, que asi se recorre una sola vez al final.
+     *
+     * @param leer Funcion que copia una ventana de I_D y de I_M (de memoria o del archivo).
+     * @param ctx Contexto con M y los datos de enmascaramiento ya cargados.
+     * @param buffers Pool del que se toman los arreglos para las ventanas.
+     * @param cadena Vector al que se agregan, en orden de aplicacion, los candidatos identificados.
+     * @param consistentes Si no es nullptr, recibe los candidatos consistentes de cada etapa, en el mismo
+     *                     orden del resultado.
+     * @param operaciones Si no es nullptr, las etapas que ya estan en la cache no se vuelven a identificar y
+     *                    cada etapa nueva se guarda en ella apenas se identifica.
+     *
+     * @return El candidato ganador de cada transformacion (el elemento k es la etapa n-k), o -1 para las
+     *         etapas que no pudieron identificarse. Si el archivo de una etapa no pudo cargarse, el resultado
+     *         termina en la etapa anterior (ver contexto::esperarEtapas).
+     */
+
+    cadenaCompilada parcial;
+    vector<int> ganadores;
+    int n = ctx.cantidadEtapas() - 1;
+
+    for (int i = n; i >= 0; i--)
+    {
+        // Con precarga, la etapa puede estar cargandose todavia; si su archivo no pudo cargarse, las
+        // siguientes ya no pueden identificarse
+        if (!ctx.esperarEtapa(i))
+        {
+            break;
+        }
+        const mascaraEtapa &datos = ctx.obtenerEtapa(i);
+        size_t bytesVentana = (size_t)datos.n_pixels * 3;
+        unsigned char *ventana = buffers.obtener(bytesVentana);
+        unsigned char *ventanaIM = buffers.obtener(bytesVentana);
+        leer(datos.seed, bytesVentana, ventana, ventanaIM);
+        parcial.aplicar(ventana, ventana, ventanaIM, bytesVentana);
+
+        mascaraCandidatos encontrados = 0;
+        int ganador = identificarVentanaCache(ventana, ventanaIM, ctx, i, encontrados, operaciones);
+        ganadores.push_back(ganador);
+        if (consistentes != nullptr)
+        {
+            consistentes->push_back(encontrados);
+        }
+        if (ganador >= 0)
+        {
+            cadena.push_back(obtenerCandidato(ganador));
+            parcial.compilar(cadena);
+        }
+        buffers.devolver(ventana);
+        buffers.devolver(ventanaIM);
+    }
+
+    return ganadores;
+}
+
+void reportarCadena(const vector<int> &ganadores, ostream &salida, const vector<mascaraCandidatos> *consistentes)
+{
+    /*
+     * @brief Imprime en 'salida' la transformacion identificada en cada etapa (el resultado de identificarCadena).
+     *
+     * Si se reciben los candidatos consistentes de cada etapa, despues de cada transformacion se listan
+     * las demas operaciones que tambien explican la ventana.
+     */
+
+    for (size_t k = 0; k < ganadores.size(); k++)
+    {
+        if (ganadores[k] >= 0)
+        {
+            salida << "La transformacion " << k + 1 << " fue " << describirCandidato(obtenerCandidato(ganadores[k])) << endl;
+            for (int c = 0; consistentes != nullptr && c < cantidadCandidatos(); c++)
+            {
+                if (c != ganadores[k] && ((*consistentes)[k] & (1ULL << c)))
+                {
+                    salida << "    tambien es consistente " << describirCandidato(obtenerCandidato(c)) << endl;
+                }
+            }
+        }
+        else
+        {
+            salida << "La transformacion " << k + 1 << " no pudo identificarse" << endl;
+        }
+    }
+}
+
+bool estimarCaso(const QString &rutaDirectorio, const opcionesReconstruccion &opciones, size_t &bytesCaso, size_t &bytesIM, ostream &salida)
+{
+    /*
+     * @brief Calcula cuanto debe reservar del limite de memoria (opciones.memoria) la reconstruccion de un caso.
+     *
+     * La parte propia del caso son los datos de enmascaramiento, I_D (que se transforma en el lugar) y,
+     * con busqueda, la imagen en que se calculan las reconstrucciones alternativas. I_M se informa aparte
+     * porque puede compartirla mas de un caso (ver reconstruirLote).
+     *
+     * @param bytesCaso Recibe los bytes propios del caso.
+     * @param bytesIM Recibe los bytes de I_M.
+     * @param salida Flujo en el que se informa por que el caso no puede reconstruirse.
+     *
+     * @return false si los archivos no pudieron abrirse o si el caso no cabe en el limite completo.
+     */
+
+    necesidadMemoria necesidad = {0, 0, 0};
+    if (!estimarMemoria(rutaDirectorio, necesidad))
+    {
+        salida << "No se pudieron cargar los archivos de " << rutaDirectorio.toStdString() << endl;
+        return false;
+    }
+    bytesCaso = necesidad.fija + (opciones.busqueda ? 2 : 1) * necesidad.imagen;
+    bytesIM = necesidad.imagen;
+    if (opciones.memoria != nullptr && bytesCaso + bytesIM > opciones.memoria->total())
+    {
+        salida << "Memoria insuficiente: el caso necesita " << megabytes(bytesCaso + bytesIM) << " MB y el limite es de "
+               << megabytes(opciones.memoria->total()) << " MB (en modo streaming necesita al menos " << megabytes(necesidad.fija + 2 * necesidad.fila)
+               << " MB)" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool reconstruirCaso(const QString &rutaDirectorio, const QString &archivoSalida, poolHilos &pool, ostream &salida, const opcionesReconstruccion &opciones)
+{
+    /*
+     * @brief Reconstruye la imagen original de un caso cargando las imagenes completas en memoria.
+     *
+     * Esta función carga I_D y el contexto del directorio, identifica todas las etapas con
+     * identificarCadena (o, con opciones.busqueda, busca todas las cadenas validas con buscarCadenas),
+     * aplica la cadena compilada a I_D en una sola pasada y exporta el resultado.
+     *
+     * @param rutaDirectorio Directorio con I_D.bmp, I_M.bmp, M.bmp y los archivos M<i>.txt o M<i>.bin.
+     * @param archivoSalida Ruta del BMP reconstruido.
+     * @param pool Pool de hilos para identificar los candidatos y transformar la imagen.
+     * @param salida Flujo en el que se informa cada transformacion y el resultado.
+     * @param opciones Caches compartidas, limite de memoria y opciones del reporte (ver opcionesReconstruccion).
+     *
+     * @return true si la imagen se reconstruyo y se exporto; false en caso contrario.
+     */
+
+    // Con un limite de memoria, el caso reserva lo que necesita (ver estimarCaso) antes de cargar nada. En
+    // los modos por lotes y servicio los casos se admiten antes y llegan aqui sin limite
+    size_t bytesCaso = 0;
+    size_t bytesIM = 0;
+    if (opciones.memoria != nullptr && !estimarCaso(rutaDirectorio, opciones, bytesCaso, bytesIM, salida))
+    {
+        return false;
+    }
+    reservaMemoria reserva(opciones.memoria, bytesCaso + bytesIM);
+
+    // Carga (una sola vez) de I_M, M y todos los archivos de enmascaramiento; con precarga, los archivos
+    // de enmascaramiento se siguen leyendo en otro hilo mientras se decodifica I_D y se identifican las etapas
+    // I_D y las ventanas salen del pool de buffers de las opciones (modo servicio) o de uno propio del caso
+    poolBuffers propios;
+    poolBuffers &buffers = opciones.buffers != nullptr ? *opciones.buffers : propios;
+    bmp bmp;
+    int height_ID = 0;
+    int width_ID = 0;
+    unsigned char *ID = nullptr;
+    contexto ctx;
+    if (!ctx.cargar(rutaDirectorio, true, opciones.imagenes, opciones.precarga)
+        || (ID = cargarPixeles(rutaDirectorio + "/I_D.bmp", width_ID, height_ID, buffers)) == nullptr)
+    {
+        salida << "No se pudieron cargar los archivos de " << rutaDirectorio.toStdString() << endl;
+        return false;
+    }
+    devolucionBuffer devolucionID = {buffers, ID};
+
+    size_t totalBytes = (size_t)height_ID * width_ID * 3;
+
+    // I_M debe tener el mismo tamaño que ID para poder aplicar el XOR
+    if (totalBytes != ctx.totalBytes())
+    {
+        salida << "I_D e I_M no tienen el mismo tamaño" << endl;
+        return false;
+    }
+
+    // Primero se identifican todas las etapas usando solo sus ventanas de enmascaramiento
+    vector<candidato> cadena;
+    const unsigned char *IM = ctx.obtenerIM();
+    lectorVentana leer = [&](size_t inicio, size_t bytes, unsigned char *ventana, unsigned char *ventanaIM) {
+        memcpy(ventana, ID + inicio, bytes);
+        memcpy(ventanaIM, IM + inicio, bytes);
+    };
+    bool primeraCalculada = false; // Con busqueda y varias cadenas, la imagen de la primera se exporta en la busqueda
+    bool exportada = false;
+    if (opciones.busqueda)
+    {
+        // Con busqueda se exploran todas las cadenas consistentes; la imagen de la primera queda en
+        // 'archivoSalida' y las demas (hasta MAX_IMAGENES_ALTERNATIVAS) en archivos numerados junto a ella
+        estadisticasBusqueda estadisticas;
+        vector<vector<int>> soluciones = buscarCadenas(leer, ctx, pool, buffers, estadisticas, opciones.operaciones);
+        if (!ctx.esperarEtapas())
+        {
+            salida << "No se pudieron cargar los archivos de " << rutaDirectorio.toStdString() << endl;
+            return false;
+        }
+
+        // Dos cadenas distintas pueden dar la misma imagen (por ejemplo, si los bits que pierde un
+        // desplazamiento ya eran cero): las imagenes se comparan por su huella y se exportan una vez. La
+        // de la primera cadena se exporta apenas se calcula, para no volver a aplicarla al final. Un
+        // archivo que no pudo exportarse queda con el nombre vacio
+        vector<QString> archivos;
+        vector<unsigned long long> huellas;
+        QString base = archivoSalida.endsWith(".bmp") ? archivoSalida.left(archivoSalida.size() - 4) : archivoSalida;
+        unsigned char *alternativa = soluciones.size() > 1 ? buffers.obtener(totalBytes) : nullptr;
+        int exportadas = 0;
+        for (size_t k = 0; k < soluciones.size() && alternativa != nullptr && exportadas < MAX_IMAGENES_ALTERNATIVAS; k++)
+        {
+            vector<candidato> cadenaAlternativa;
+            for (int c : soluciones[k])
+            {
+                cadenaAlternativa.push_back(obtenerCandidato(c));
+            }
+            cadenaCompilada compilada;
+            compilada.compilar(cadenaAlternativa);
+            compilada.aplicar(alternativa, ID, IM, totalBytes, pool);
+            huellas.push_back(huellaBytes(alternativa, totalBytes));
+            size_t igual = 0;
+            while (igual < k && huellas[igual] != huellas[k])
+            {
+                igual++;
+            }
+            if (igual < k)
+            {
+                archivos.push_back(archivos[igual]);
+                continue;
+            }
+
+            QString archivo = k == 0 ? archivoSalida : base + "_" + QString::number(k + 1) + ".bmp";
+            bool correcto = bmp.exportImage(alternativa, width_ID, height_ID, archivo);
+            if (k == 0)
+            {
+                primeraCalculada = true;
+                exportada = correcto;
+            }
+            else if (correcto)
+            {
+                exportadas++;
+            }
+            else
+            {
+                salida << "No se pudo exportar " << archivo.toStdString() << endl;
+            }
+            archivos.push_back(correcto ? archivo : QString());
+        }
+        if (alternativa != nullptr)
+        {
+            buffers.devolver(alternativa);
+        }
+        else if (!soluciones.empty())
+        {
+            archivos.push_back(archivoSalida);
+        }
+
+        reportarBusqueda(soluciones, estadisticas, archivos, salida);
+        if (soluciones.empty())
+        {
+            return false;
+        }
+        for (int c : soluciones[0])
+        {
+            cadena.push_back(obtenerCandidato(c));
+        }
+    }
+    else
+    {
+        vector<mascaraCandidatos> consistentes;
+        vector<int> ganadores = identificarCadena(leer, ctx, buffers, cadena, &consistentes, opciones.operaciones);
+        if (!ctx.esperarEtapas())
+        {
+            salida << "No se pudieron cargar los archivos de " << rutaDirectorio.toStdString() << endl;
+            return false;
+        }
+        reportarCadena(ganadores, salida, opciones.reportarConsistentes ? &consistentes : nullptr);
+    }
+
+    // Luego la cadena completa se aplica a la imagen en una sola pasada y en el lugar: cada byte solo
+    // depende de si mismo y del byte de I_M en su posicion, por lo que no hace falta otra imagen
+    if (!primeraCalculada)
+    {
+        cadenaCompilada compilada;
+        compilada.compilar(cadena);
+        compilada.aplicar(ID, ID, IM, totalBytes, pool);
+
+        // Exportando ID, en este punto ya es IO (vuelve al pool de buffers al salir)
+        exportada = bmp.exportImage(ID, width_ID, height_ID, archivoSalida);
+    }
+    if (exportada)
+    {
+        salida << "Imagen original reconstruida correctamente" << endl;
+        return true;
+    }
+    salida << "Ocurrio un error al reconstruir la imagen" << endl;
+    return false;
+}
@@ -0,0 +1,48 @@
+#ifndef RECONSTRUCCION_H
+#define RECONSTRUCCION_H
+
+#include "identificacion.h"
+#include "operaciones.h"
+
+#include <QString>
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+class cacheImagenes;
+class cacheOperaciones;
+class contexto;
+class limiteMemoria;
+class poolBuffers;
+class poolHilos;
+
+int identificarVentana(const unsigned char *ventana, const unsigned char *ventanaIM, const contexto &ctx, int etapa, mascaraCandidatos *consistentes = nullptr);
+int identificarVentanaCache(const unsigned char *ventana, const unsigned char *ventanaIM, const contexto &ctx, int etapa, mascaraCandidatos &consistentes,
+                            cacheOperaciones *operaciones);
+
+// Copia en 'ventana' y 'ventanaIM' los 'bytes' bytes de I_D y de I_M que empiezan en 'inicio'
+typedef std::function<void(size_t inicio, size_t bytes, unsigned char *ventana, unsigned char *ventanaIM)> lectorVentana;
+
+std::vector<int> identificarCadena(const lectorVentana &leer, const contexto &ctx, poolBuffers &buffers, std::vector<candidato> &cadena,
+                                   std::vector<mascaraCandidatos> *consistentes = nullptr, cacheOperaciones *operaciones = nullptr);
+void reportarCadena(const std::vector<int> &ganadores, std::ostream &salida, const std::vector<mascaraCandidatos> *consistentes = nullptr);
+
+// Recursos y opciones (todos opcionales) que comparten las reconstrucciones de un mismo proceso
+struct opcionesReconstruccion
+{
+    cacheImagenes *imagenes = nullptr;       // Cache de la que se toma I_M (modo por lotes)
+    cacheOperaciones *operaciones = nullptr; // Cache persistente de las etapas ya identificadas
+    poolBuffers *buffers = nullptr;          // Arreglos que se reutilizan de un caso al siguiente (modo servicio)
+    limiteMemoria *memoria = nullptr;        // Limite de memoria compartido por todos los casos del proceso
+    int precarga = 2;                        // Etapas que se cargan por adelantado en otro hilo (0: ninguna)
+    bool reportarConsistentes = false;       // Listar tambien las demas operaciones consistentes de cada etapa
+    bool busqueda = false;                   // Explorar todas las cadenas consistentes en vez de la primera (ver buscarCadenas)
+};
+
+bool estimarCaso(const QString &rutaDirectorio, const opcionesReconstruccion &opciones, size_t &bytesCaso, size_t &bytesIM, std::ostream &salida);
+bool reconstruirCaso(const QString &rutaDirectorio, const QString &archivoSalida, poolHilos &pool, std::ostream &salida,
+                     const opcionesReconstruccion &opciones = opcionesReconstruccion());
+
+#endif // RECONSTRUCCION_H
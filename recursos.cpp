@@ -0,0 +1,320 @@
+#include "recursos.h"
+#include "bmp.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+imagenCompartida::~imagenCompartida()
+{
+    delete[] pixeles;
+}
+
+cacheImagenes::cacheImagenes()
+    : cargas(0), aciertos(0), usos(0), limiteConservadas(0)
+{
+}
+
+shared_ptr<cacheImagenes::entrada> cacheImagenes::buscar(const QString &ruta)
+{
+    /*
+     * @brief Retorna la entrada de la ruta canonica de 'ruta' (creandola si no existe), o nullptr si el archivo no existe.
+     */
+
+    string clave = QFileInfo(ruta).canonicalFilePath().toStdString();
+    if (clave.empty())
+    {
+        return nullptr;
+    }
+
+    lock_guard<mutex> bloqueo(candado);
+    shared_ptr<entrada> &e = entradas[clave];
+    if (!e)
+    {
+        e = make_shared<entrada>();
+        e->pendientes = 0;
+        e->tamanio = -1;
+        e->modificado = -1;
+        e->ultimoUso = 0;
+    }
+    return e;
+}
+
+void cacheImagenes::reservar(const QString &ruta)
+{
+    /*
+     * @brief Anuncia un uso futuro de 'ruta', para que la imagen se conserve desde que se decodifica hasta
+     *        que el uso se libere con liberar().
+     */
+
+    shared_ptr<entrada> e = buscar(ruta);
+    if (e)
+    {
+        lock_guard<mutex> bloqueo(e->candado);
+        e->pendientes++;
+    }
+}
+
+void cacheImagenes::liberar(const QString &ruta)
+{
+    /*
+     * @brief Termina un uso anunciado con reservar(), haya llegado o no a obtener() la imagen.
+     *
+     * Cada reservar() debe tener su liberar(), tambien cuando el caso falla antes de cargar I_M; sin usos
+     * pendientes, la cache deja de retener la imagen (salvo con conservar()).
+     */
+
+    shared_ptr<entrada> e = buscar(ruta);
+    if (!e)
+    {
+        return;
+    }
+
+    unique_lock<mutex> bloqueo(e->candado);
+    if (e->pendientes > 0)
+    {
+        e->pendientes--;
+    }
+    if (e->pendientes == 0 && limiteConservadas == 0)
+    {
+        e->retenida = nullptr;
+    }
+    bloqueo.unlock();
+
+    if (limiteConservadas > 0)
+    {
+        recortar();
+    }
+}
+
+void cacheImagenes::conservar(size_t bytesMaximos)
+{
+    /*
+     * @brief Retiene las imagenes entre casos aunque no tengan usos reservados (modo servicio).
+     *
+     * @param bytesMaximos Total de bytes de pixeles que se retienen; al superarlo se descartan las imagenes
+     *                     usadas hace mas tiempo (que siguen vivas mientras las use algun contexto).
+     *
+     * @note Debe llamarse antes de empezar a usar la cache.
+     */
+
+    limiteConservadas = bytesMaximos;
+}
+
+shared_ptr<const imagenCompartida> cacheImagenes::obtener(const QString &ruta)
+{
+    /*
+     * @brief Retorna la imagen de 'ruta', decodificandola solo si no esta en la cache ni la usa otro contexto.
+     *
+     * @param ruta Ruta del BMP. Dos rutas que llevan al mismo archivo comparten la misma entrada.
+     *
+     * @return La imagen compartida, o nullptr si el archivo no existe o no pudo decodificarse.
+     */
+
+    shared_ptr<entrada> e = buscar(ruta);
+    if (!e)
+    {
+        return nullptr;
+    }
+
+    // Un archivo que cambio desde que se decodifico (por ejemplo, entre dos casos de un servicio) se
+    // vuelve a decodificar; los contextos que usan la version anterior la conservan hasta terminar
+    QFileInfo informacion(ruta);
+    long long tamanio = informacion.size();
+    long long modificado = informacion.lastModified().toMSecsSinceEpoch();
+
+    unique_lock<mutex> bloqueo(e->candado);
+    shared_ptr<const imagenCompartida> imagen = e->imagen.lock();
+    if (imagen && (e->tamanio != tamanio || e->modificado != modificado))
+    {
+        imagen = nullptr;
+    }
+    if (imagen)
+    {
+        aciertos++;
+    }
+    else
+    {
+        bmp bmp;
+        int ancho = 0;
+        int alto = 0;
+        unsigned char *pixeles = bmp.loadPixels(ruta, ancho, alto);
+        if (pixeles == nullptr)
+        {
+            return nullptr;
+        }
+        shared_ptr<imagenCompartida> nueva = make_shared<imagenCompartida>();
+        nueva->pixeles = pixeles;
+        nueva->ancho = ancho;
+        nueva->alto = alto;
+        imagen = nueva;
+        e->imagen = imagen;
+        e->tamanio = tamanio;
+        e->modificado = modificado;
+        cargas++;
+    }
+
+    // La cache retiene la imagen mientras queden usos reservados o, con conservar(), hasta que se recorte
+    e->retenida = e->pendientes > 0 || limiteConservadas > 0 ? imagen : nullptr;
+    e->ultimoUso = ++usos;
+    bloqueo.unlock();
+
+    if (limiteConservadas > 0)
+    {
+        recortar();
+    }
+    return imagen;
+}
+
+void cacheImagenes::recortar()
+{
+    /*
+     * @brief Deja de retener las imagenes usadas hace mas tiempo hasta que las retenidas quepan en el limite de conservar().
+     *
+     * Cada entrada se bloquea por separado (nunca junto con el candado del mapa), de modo que el recorte
+     * no se cruza con un obtener() de otro hilo; una imagen que se volvio a usar mientras tanto no se descarta.
+     */
+
+    vector<shared_ptr<entrada>> todas;
+    {
+        lock_guard<mutex> bloqueo(candado);
+        for (const auto &par : entradas)
+        {
+            todas.push_back(par.second);
+        }
+    }
+
+    struct retenida
+    {
+        shared_ptr<entrada> e;
+        unsigned long long uso;
+        size_t bytes;
+    };
+    vector<retenida> retenidas;
+    size_t total = 0;
+    for (const shared_ptr<entrada> &e : todas)
+    {
+        lock_guard<mutex> bloqueo(e->candado);
+        if (e->retenida && e->pendientes <= 0)
+        {
+            size_t bytes = (size_t)e->retenida->ancho * e->retenida->alto * 3;
+            retenidas.push_back({e, e->ultimoUso, bytes});
+            total += bytes;
+        }
+    }
+
+    sort(retenidas.begin(), retenidas.end(), [](const retenida &a, const retenida &b) { return a.uso < b.uso; });
+    for (size_t k = 0; k < retenidas.size() && total > limiteConservadas; k++)
+    {
+        lock_guard<mutex> bloqueo(retenidas[k].e->candado);
+        if (retenidas[k].e->ultimoUso == retenidas[k].uso)
+        {
+            retenidas[k].e->retenida = nullptr;
+            total -= retenidas[k].bytes;
+        }
+    }
+}
+
+size_t cacheImagenes::cantidadCargas() const
+{
+    return cargas.load();
+}
+
+size_t cacheImagenes::cantidadAciertos() const
+{
+    return aciertos.load();
+}
+
+size_t cacheImagenes::bytesConservados() const
+{
+    /*
+     * @brief Bytes de pixeles de las imagenes que la cache retiene en este momento.
+     */
+
+    vector<shared_ptr<entrada>> todas;
+    {
+        lock_guard<mutex> bloqueo(candado);
+        for (const auto &par : entradas)
+        {
+            todas.push_back(par.second);
+        }
+    }
+    size_t total = 0;
+    for (const shared_ptr<entrada> &e : todas)
+    {
+        lock_guard<mutex> bloqueo(e->candado);
+        if (e->retenida)
+        {
+            total += (size_t)e->retenida->ancho * e->retenida->alto * 3;
+        }
+    }
+    return total;
+}
+
+string claveImagen(const QString &ruta)
+{
+    /*
+     * @brief Clave de una imagen: su ruta canonica (o la ruta recibida, si el archivo no existe).
+     */
+
+    QString canonica = QFileInfo(ruta).canonicalFilePath();
+    return (canonica.isEmpty() ? ruta : canonica).toStdString();
+}
+
+imagenesAdmitidas::imagenesAdmitidas(cacheImagenes &cache, limiteMemoria *limite)
+    : cache(cache), limite(limite)
+{
+}
+
+void imagenesAdmitidas::anunciar(const QString &ruta)
+{
+    /*
+     * @brief Anuncia a la cache un caso mas que va a usar la imagen de 'ruta' (ver cacheImagenes::reservar).
+     */
+
+    cache.reservar(ruta);
+    lock_guard<mutex> bloqueo(candado);
+    usos[claveImagen(ruta)].restantes++;
+}
+
+void imagenesAdmitidas::admitir(const QString &ruta, size_t bytes)
+{
+    /*
+     * @brief Reserva 'bytes' del limite para la imagen si ningun caso admitido antes la usa.
+     *
+     * Puede esperar a que terminen otros casos: no debe llamarse desde un hilo del pool.
+     */
+
+    unique_ptr<reservaMemoria> reserva;
+    {
+        lock_guard<mutex> bloqueo(candado);
+        if (usos[claveImagen(ruta)].reserva)
+        {
+            return;
+        }
+    }
+    reserva.reset(new reservaMemoria(limite, bytes));
+    lock_guard<mutex> bloqueo(candado);
+    usos[claveImagen(ruta)].reserva = move(reserva);
+}
+
+void imagenesAdmitidas::terminar(const QString &ruta)
+{
+    /*
+     * @brief Termina un uso anunciado; con el ultimo, la imagen libera su reserva.
+     */
+
+    cache.liberar(ruta);
+    unique_ptr<reservaMemoria> reserva;
+    lock_guard<mutex> bloqueo(candado);
+    map<string, uso>::iterator u = usos.find(claveImagen(ruta));
+    if (u != usos.end() && --u->second.restantes == 0)
+    {
+        reserva = move(u->second.reserva);
+        usos.erase(u);
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef RECURSOS_H
+#define RECURSOS_H
+
+#include "memoria.h"
+
+#include <QString>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Imagen decodificada que pueden compartir varios contextos (por ejemplo, la I_M de muchos casos)
+struct imagenCompartida
+{
+    unsigned char *pixeles;
+    int ancho;
+    int alto;
+
+    ~imagenCompartida();
+};
+
+// Cache de imagenes decodificadas indexada por la ruta canonica del archivo: los casos cuyos I_M son
+// el mismo archivo (directamente o por enlaces) comparten una sola copia en memoria. La cache solo
+// mantiene viva una imagen mientras tenga usos anunciados con reservar() que no se liberaron con
+// liberar(); despues, la imagen se libera cuando deja de usarla el ultimo contexto. Con conservar() (modo servicio) las imagenes se retienen
+// ademas entre casos, hasta un total de bytes, y se descartan primero las usadas hace mas tiempo.
+class cacheImagenes
+{
+public:
+    cacheImagenes();
+
+    void reservar(const QString &ruta);
+    void liberar(const QString &ruta);
+    void conservar(size_t bytesMaximos);
+    std::shared_ptr<const imagenCompartida> obtener(const QString &ruta);
+
+    size_t cantidadCargas() const;
+    size_t cantidadAciertos() const;
+    size_t bytesConservados() const;
+
+private:
+    struct entrada
+    {
+        std::mutex candado; // Evita que dos casos decodifiquen a la vez el mismo archivo
+        std::shared_ptr<const imagenCompartida> retenida; // Mientras 'pendientes' > 0 o, con conservar(), hasta que se recorte
+        std::weak_ptr<const imagenCompartida> imagen;
+        int pendientes;
+        long long tamanio;    // Tamaño y fecha de modificacion del archivo al decodificarlo: si cambian,
+        long long modificado; // la imagen se vuelve a decodificar
+        unsigned long long ultimoUso;
+    };
+
+    std::shared_ptr<entrada> buscar(const QString &ruta);
+    void recortar();
+
+    cacheImagenes(const cacheImagenes &) = delete;
+    cacheImagenes &operator=(const cacheImagenes &) = delete;
+
+    std::map<std::string, std::shared_ptr<entrada>> entradas;
+    mutable std::mutex candado;
+    std::atomic<size_t> cargas;
+    std::atomic<size_t> aciertos;
+    std::atomic<unsigned long long> usos;
+    size_t limiteConservadas; // 0: solo se retienen las imagenes con usos reservados
+};
+
+std::string claveImagen(const QString &ruta);
+
+// Usos de las I_M de una cacheImagenes por varios casos (modo por lotes y modo servicio): cada caso
+// anuncia su I_M a la cache y, con un limite de memoria, la imagen se reserva de el una sola vez, desde
+// que se admite el primero de los casos que la usan hasta que termina el ultimo (que es cuando la cache
+// deja de retenerla por esos casos)
+class imagenesAdmitidas
+{
+public:
+    imagenesAdmitidas(cacheImagenes &cache, limiteMemoria *limite);
+
+    void anunciar(const QString &ruta);
+    void admitir(const QString &ruta, size_t bytes);
+    void terminar(const QString &ruta);
+
+private:
+    struct uso
+    {
+        int restantes = 0;
+        std::unique_ptr<reservaMemoria> reserva;
+    };
+
+    imagenesAdmitidas(const imagenesAdmitidas &) = delete;
+    imagenesAdmitidas &operator=(const imagenesAdmitidas &) = delete;
+
+    cacheImagenes &cache;
+    limiteMemoria *limite;
+    std::mutex candado;
+    std::map<std::string, uso> usos;
+};
+
+// Termina al salir del alcance, por cualquier camino, el uso de I_M que se anuncio para un caso: un caso
+// que falla antes de cargar I_M (por ejemplo, porque le falta un archivo M<i>) no llega a obtener()
+struct terminacionImagen
+{
+    imagenesAdmitidas &imagenes;
+    QString ruta;
+
+    ~terminacionImagen()
+    {
+        imagenes.terminar(ruta);
+    }
+};
+
+#endif // RECURSOS_H
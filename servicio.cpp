@@ -0,0 +1,519 @@
+#include "servicio.h"
+#include "buffers.h"
+#include "cacheoperaciones.h"
+#include "memoria.h"
+#include "pool.h"
+#include "recursos.h"
+
+#include <QFile>
+#include <QtGlobal>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(Q_OS_UNIX)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#if defined(Q_OS_UNIX)
+namespace
+{
+const size_t BYTES_IMAGENES_SERVICIO = 512u << 20; // I_M decodificadas que se conservan entre casos
+const size_t BYTES_BUFFERS_SERVICIO = 256u << 20;  // Arreglos del pool que se conservan entre casos
+const int FRACCION_CONSERVADA = 4;                 // Con --memoria, cada uno de los dos anteriores es a lo sumo 1/4 del limite
+const int MUESTRAS_LATENCIA = 1024;                // Ultimas latencias con las que se calculan los percentiles
+const int MAX_CONEXIONES = 64;                     // Conexiones atendidas a la vez; las demas esperan en la cola del socket
+const size_t LARGO_MAXIMO_LINEA = 4096;
+const qint64 BYTES_TRAMO_ENVIO = 1 << 20;          // Tramo en que se envia el BMP de RECONSTRUIR_BYTES
+
+volatile sig_atomic_t senalDetener = 0;
+
+void alRecibirSenal(int)
+{
+    senalDetener = 1;
+}
+
+// Contadores y latencias de las reconstrucciones atendidas
+class estadisticasServicio
+{
+public:
+    estadisticasServicio()
+        : solicitudes(0), errores(0), totalMilisegundos(0.0), maximoMilisegundos(0.0), inicio(chrono::steady_clock::now())
+    {
+    }
+
+    void registrar(double milisegundos, bool correcto)
+    {
+        lock_guard<mutex> bloqueo(candado);
+        if ((int)recientes.size() < MUESTRAS_LATENCIA)
+        {
+            recientes.push_back(milisegundos);
+        }
+        else
+        {
+            recientes[solicitudes % MUESTRAS_LATENCIA] = milisegundos;
+        }
+        solicitudes++;
+        errores += correcto ? 0 : 1;
+        totalMilisegundos += milisegundos;
+        maximoMilisegundos = max(maximoMilisegundos, milisegundos);
+    }
+
+    string resumen() const
+    {
+        /*
+         * @brief Contadores en formato 'clave=valor': solicitudes, errores, latencia media, p50, p95 y
+         *        maxima (los percentiles, de las ultimas MUESTRAS_LATENCIA), y reconstrucciones por segundo
+         *        desde que empezo el servicio.
+         */
+
+        lock_guard<mutex> bloqueo(candado);
+        vector<double> ordenadas = recientes;
+        sort(ordenadas.begin(), ordenadas.end());
+        auto percentil = [&](double p) { return ordenadas.empty() ? 0.0 : ordenadas[(size_t)(p * (ordenadas.size() - 1) + 0.5)]; };
+        double segundos = chrono::duration<double>(chrono::steady_clock::now() - inicio).count();
+
+        char texto[256];
+        snprintf(texto, sizeof(texto), "solicitudes=%lld errores=%lld media_ms=%.3f p50_ms=%.3f p95_ms=%.3f max_ms=%.3f por_segundo=%.2f activo_s=%.1f",
+                 solicitudes, errores, solicitudes > 0 ? totalMilisegundos / solicitudes : 0.0, percentil(0.5), percentil(0.95), maximoMilisegundos,
+                 segundos > 0 ? solicitudes / segundos : 0.0, segundos);
+        return texto;
+    }
+
+private:
+    mutable mutex candado;
+    long long solicitudes;
+    long long errores;
+    double totalMilisegundos;
+    double maximoMilisegundos;
+    vector<double> recientes;
+    chrono::steady_clock::time_point inicio;
+};
+
+// Lo que comparten el hilo que acepta conexiones y los hilos de los clientes
+struct estadoServicio
+{
+    estadoServicio(poolHilos &pool, const opcionesReconstruccion &opciones, cacheImagenes &imagenes, poolBuffers &buffers, size_t bytesBuffers)
+        : pool(pool), opciones(opciones), opcionesCaso(opciones), imagenes(imagenes), buffers(buffers), bytesBuffers(bytesBuffers),
+          admitidas(imagenes, opciones.memoria), detener(false), activos(0), trabajosLibres(max(1, pool.cantidadHilos()))
+    {
+        opcionesCaso.memoria = nullptr; // Los casos se admiten antes de reconstruirlos (ver atenderSolicitud)
+    }
+
+    poolHilos &pool;
+    opcionesReconstruccion opciones;
+    opcionesReconstruccion opcionesCaso;
+    cacheImagenes &imagenes;
+    poolBuffers &buffers;
+    size_t bytesBuffers; // Arreglos libres que se conservan entre casos
+    imagenesAdmitidas admitidas;
+    mutex admision; // Los casos se admiten de a uno (ver atenderSolicitud)
+    estadisticasServicio estadisticas;
+    atomic<bool> detener;
+
+    mutex candado; // Protege 'clientes', 'activos' y 'trabajosLibres'
+    condition_variable terminoCliente;
+    condition_variable terminoTrabajo;
+    vector<int> clientes;
+    int activos;
+    int trabajosLibres; // Reconstrucciones que todavia pueden empezar: a lo sumo una por hilo del pool
+};
+
+// Turno para una reconstruccion: espera (en el hilo del cliente, no en el pool) a que haya uno libre y
+// lo devuelve al destruirse. Sin turno (valido() false) el servicio se esta deteniendo.
+class turnoTrabajo
+{
+public:
+    explicit turnoTrabajo(estadoServicio &estado) : estado(estado)
+    {
+        unique_lock<mutex> bloqueo(estado.candado);
+        estado.terminoTrabajo.wait(bloqueo, [&] { return estado.trabajosLibres > 0 || estado.detener; });
+        obtenido = !estado.detener;
+        estado.trabajosLibres -= obtenido ? 1 : 0;
+    }
+
+    ~turnoTrabajo()
+    {
+        if (obtenido)
+        {
+            lock_guard<mutex> bloqueo(estado.candado);
+            estado.trabajosLibres++;
+            estado.terminoTrabajo.notify_one();
+        }
+    }
+
+    bool valido() const
+    {
+        return obtenido;
+    }
+
+private:
+    turnoTrabajo(const turnoTrabajo &) = delete;
+    turnoTrabajo &operator=(const turnoTrabajo &) = delete;
+
+    estadoServicio &estado;
+    bool obtenido;
+};
+
+bool enviar(int descriptor, const char *datos, size_t bytes)
+{
+    while (bytes > 0)
+    {
+        ssize_t enviados = send(descriptor, datos, bytes, 0);
+        if (enviados <= 0)
+        {
+            return false;
+        }
+        datos += enviados;
+        bytes -= (size_t)enviados;
+    }
+    return true;
+}
+
+bool enviarLinea(int descriptor, const string &linea)
+{
+    string conSalto = linea + "\n";
+    return enviar(descriptor, conSalto.data(), conSalto.size());
+}
+
+bool atenderSolicitud(int descriptor, const string &linea, estadoServicio &estado)
+{
+    /*
+     * @brief Atiende una linea del protocolo (ver servicio.h) y envia su respuesta.
+     *
+     * @return false si la conexion debe cerrarse (DETENER o un error al enviar).
+     */
+
+    size_t espacio = linea.find(' ');
+    size_t inicioArgumento = espacio == string::npos ? string::npos : linea.find_first_not_of(' ', espacio);
+    string comando = linea.substr(0, espacio);
+    string argumento = inicioArgumento == string::npos ? string() : linea.substr(inicioArgumento);
+
+    if (comando == "ESTADISTICAS")
+    {
+        ostringstream texto;
+        texto << "OK " << estado.estadisticas.resumen() << " imagenes_cargadas=" << estado.imagenes.cantidadCargas()
+              << " imagenes_reutilizadas=" << estado.imagenes.cantidadAciertos() << " imagenes_mb=" << megabytes(estado.imagenes.bytesConservados())
+              << " buffers_mb=" << megabytes(estado.buffers.bytesReservados()) << " memoria_mb=" << megabytes(memoriaPico());
+        if (estado.opciones.operaciones != nullptr)
+        {
+            texto << " etapas_reutilizadas=" << estado.opciones.operaciones->cantidadAciertos() << " etapas_nuevas=" << estado.opciones.operaciones->cantidadNuevas();
+        }
+        return enviarLinea(descriptor, texto.str());
+    }
+    if (comando == "DETENER")
+    {
+        estado.detener = true;
+        enviarLinea(descriptor, "OK");
+        return false;
+    }
+    if (comando != "RECONSTRUIR" && comando != "RECONSTRUIR_BYTES")
+    {
+        return enviarLinea(descriptor, "ERROR comando desconocido: " + comando);
+    }
+    if (argumento.empty())
+    {
+        return enviarLinea(descriptor, "ERROR falta el directorio del caso");
+    }
+
+    // La reconstruccion usa el pool de hilos, el pool de buffers y la cache de imagenes del servicio. Solo
+    // corren a la vez tantas como hilos tiene el pool (ver turnoTrabajo); la latencia incluye la espera
+    QString directorio = argumento.c_str();
+    QString archivoSalida = directorio + "/I_O.bmp";
+    QString rutaIM = directorio + "/I_M.bmp";
+    chrono::steady_clock::time_point inicio = chrono::steady_clock::now();
+    ostringstream mensajes;
+    bool correcto = false;
+    {
+        turnoTrabajo turno(estado);
+        if (!turno.valido())
+        {
+            return enviarLinea(descriptor, "ERROR el servicio se esta deteniendo");
+        }
+
+        // Con un limite de memoria el caso se admite como en el modo por lotes: reserva su parte y la de su
+        // I_M, que se cuenta una sola vez aunque la usen varias solicitudes a la vez. Las admisiones son de
+        // a una y el uso de I_M se anuncia recien al admitir el caso: asi, la reserva de una imagen solo la
+        // retienen casos admitidos, que terminan y la liberan mientras el siguiente espera su turno
+        size_t bytesCaso = 0;
+        size_t bytesIM = 0;
+        bool admitido = estado.opciones.memoria == nullptr || estimarCaso(directorio, estado.opciones, bytesCaso, bytesIM, mensajes);
+        unique_ptr<reservaMemoria> reserva;
+        unique_ptr<terminacionImagen> terminacion;
+        if (admitido)
+        {
+            lock_guard<mutex> bloqueo(estado.admision);
+            estado.admitidas.anunciar(rutaIM);
+            terminacion.reset(new terminacionImagen{estado.admitidas, rutaIM});
+            estado.admitidas.admitir(rutaIM, bytesIM);
+            reserva.reset(new reservaMemoria(estado.opciones.memoria, bytesCaso));
+        }
+        correcto = admitido && reconstruirCaso(directorio, archivoSalida, estado.pool, mensajes, estado.opcionesCaso);
+        reserva.reset();
+
+        // Los arreglos libres se conservan para el proximo caso, salvo que ocupen demasiado
+        if (estado.buffers.bytesReservados() > estado.bytesBuffers)
+        {
+            estado.buffers.vaciar();
+        }
+    }
+    double milisegundos = chrono::duration<double, milli>(chrono::steady_clock::now() - inicio).count();
+    estado.estadisticas.registrar(milisegundos, correcto);
+
+    istringstream lineas(mensajes.str());
+    string mensaje;
+    string primero;
+    while (getline(lineas, mensaje))
+    {
+        primero = primero.empty() ? mensaje : primero;
+        if (!enviarLinea(descriptor, "- " + mensaje))
+        {
+            return false;
+        }
+    }
+    if (!correcto)
+    {
+        return enviarLinea(descriptor, "ERROR " + (primero.empty() ? string("no se pudo reconstruir el caso") : primero));
+    }
+
+    char tiempo[32];
+    snprintf(tiempo, sizeof(tiempo), "%.3f", milisegundos);
+    if (comando == "RECONSTRUIR")
+    {
+        return enviarLinea(descriptor, "OK " + archivoSalida.toStdString() + " " + tiempo);
+    }
+
+    // El BMP se envia por tramos, sin leerlo completo en memoria. Si falla la lectura despues de anunciar
+    // el tamaño, la respuesta queda incompleta y la conexion se cierra
+    QFile archivo(archivoSalida);
+    if (!archivo.open(QIODevice::ReadOnly))
+    {
+        return enviarLinea(descriptor, "ERROR no se pudo leer " + archivoSalida.toStdString());
+    }
+    qint64 restantes = archivo.size();
+    if (!enviarLinea(descriptor, "OK " + to_string(restantes) + " " + tiempo))
+    {
+        return false;
+    }
+    vector<char> tramo((size_t)min(restantes, BYTES_TRAMO_ENVIO));
+    while (restantes > 0)
+    {
+        qint64 leidos = archivo.read(tramo.data(), min(restantes, BYTES_TRAMO_ENVIO));
+        if (leidos <= 0 || !enviar(descriptor, tramo.data(), (size_t)leidos))
+        {
+            return false;
+        }
+        restantes -= leidos;
+    }
+    return true;
+}
+
+void atenderCliente(int descriptor, estadoServicio &estado)
+{
+    /*
+     * @brief Lee las solicitudes de una conexion, una por linea, hasta que el cliente la cierra.
+     */
+
+    string pendiente;
+    char buffer[4096];
+    bool abierta = true;
+    while (abierta && !estado.detener)
+    {
+        size_t fin = pendiente.find('\n');
+        if (fin == string::npos)
+        {
+            if (pendiente.size() > LARGO_MAXIMO_LINEA)
+            {
+                enviarLinea(descriptor, "ERROR linea demasiado larga");
+                break;
+            }
+            ssize_t leidos = recv(descriptor, buffer, sizeof(buffer), 0);
+            abierta = leidos > 0;
+            pendiente.append(buffer, leidos > 0 ? (size_t)leidos : 0);
+            continue;
+        }
+
+        string linea = pendiente.substr(0, fin);
+        pendiente.erase(0, fin + 1);
+        if (!linea.empty() && linea.back() == '\r')
+        {
+            linea.pop_back();
+        }
+        if (!linea.empty())
+        {
+            abierta = atenderSolicitud(descriptor, linea, estado);
+        }
+    }
+
+    // El descriptor se cierra con el candado tomado, para que el hilo principal no lo use despues
+    lock_guard<mutex> bloqueo(estado.candado);
+    estado.clientes.erase(find(estado.clientes.begin(), estado.clientes.end(), descriptor));
+    close(descriptor);
+    estado.activos--;
+    estado.terminoCliente.notify_all();
+}
+}
+#endif
+
+bool ejecutarServicio(const QString &rutaSocket, poolHilos &pool, const opcionesReconstruccion &opciones, ostream &registro)
+{
+    /*
+     * @brief Atiende reconstrucciones por un socket de dominio Unix hasta recibir DETENER, SIGINT o SIGTERM.
+     *
+     * Cada conexion (hasta MAX_CONEXIONES a la vez) tiene su propio hilo, que atiende sus solicitudes en
+     * orden; las reconstrucciones de varias conexiones se reparten entre los hilos de 'pool', como los
+     * casos del modo por lotes, y corren a la vez a lo sumo tantas como hilos tiene el pool. Entre
+     * un caso y el siguiente se conservan el pool de hilos, los arreglos del pool de buffers (hasta
+     * BYTES_BUFFERS_SERVICIO) y las I_M decodificadas (hasta BYTES_IMAGENES_SERVICIO, ver
+     * cacheImagenes::conservar), que se vuelven a decodificar si el archivo cambia. Asi, un caso chico
+     * cuesta poco mas que sus transformaciones.
+     *
+     * Con un limite de memoria (opciones.memoria), lo que se conserva entre casos sale del limite: cada
+     * presupuesto se reduce a lo sumo a 1/FRACCION_CONSERVADA del limite, y los casos se admiten con lo
+     * que queda. Cada solicitud reserva su parte y la de su I_M; una I_M que usan varias solicitudes a
+     * la vez se cuenta una sola vez.
+     *
+     * @param rutaSocket Ruta del socket; si ya existe un socket en esa ruta (de un servicio anterior) se reemplaza.
+     * @param pool Pool de hilos del servicio.
+     * @param opciones Opciones de todos los casos (cache de operaciones, limite de memoria, busqueda, ...); la
+     *                 cache de imagenes y el pool de buffers los crea el servicio.
+     * @param registro Flujo en el que se informa el inicio, el fin y los errores del servicio.
+     *
+     * @return true si el servicio termino normalmente; false si no pudo crearse el socket.
+     */
+
+#if defined(Q_OS_UNIX)
+    string ruta = rutaSocket.toStdString();
+    sockaddr_un direccion;
+    memset(&direccion, 0, sizeof(direccion));
+    direccion.sun_family = AF_UNIX;
+    if (ruta.empty() || ruta.size() >= sizeof(direccion.sun_path))
+    {
+        registro << "La ruta del socket debe tener entre 1 y " << sizeof(direccion.sun_path) - 1 << " caracteres" << endl;
+        return false;
+    }
+    memcpy(direccion.sun_path, ruta.c_str(), ruta.size());
+
+    // Solo se reemplaza un socket; cualquier otro archivo en la ruta es un error
+    struct stat informacion;
+    if (lstat(ruta.c_str(), &informacion) == 0)
+    {
+        if (!S_ISSOCK(informacion.st_mode))
+        {
+            registro << ruta << " ya existe y no es un socket" << endl;
+            return false;
+        }
+        unlink(ruta.c_str());
+    }
+
+    int escucha = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (escucha < 0 || bind(escucha, (const sockaddr *)&direccion, sizeof(direccion)) != 0 || listen(escucha, 64) != 0)
+    {
+        registro << "No se pudo crear el socket " << ruta << ": " << strerror(errno) << endl;
+        if (escucha >= 0)
+        {
+            close(escucha);
+        }
+        return false;
+    }
+
+    // Un cliente que cierra la conexion antes de la respuesta no debe terminar el proceso
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, alRecibirSenal);
+    signal(SIGTERM, alRecibirSenal);
+
+    // Las imagenes y los arreglos que se conservan entre casos se descuentan del limite de memoria
+    size_t bytesImagenes = BYTES_IMAGENES_SERVICIO;
+    size_t bytesBuffers = BYTES_BUFFERS_SERVICIO;
+    unique_ptr<limiteMemoria> limiteCasos;
+    opcionesReconstruccion opcionesServicio = opciones;
+    if (opciones.memoria != nullptr)
+    {
+        bytesImagenes = min(bytesImagenes, opciones.memoria->total() / FRACCION_CONSERVADA);
+        bytesBuffers = min(bytesBuffers, opciones.memoria->total() / FRACCION_CONSERVADA);
+        limiteCasos.reset(new limiteMemoria(opciones.memoria->total() - bytesImagenes - bytesBuffers));
+        opcionesServicio.memoria = limiteCasos.get();
+        registro << "Memoria: " << megabytes(limiteCasos->total()) << " MB para los casos, " << megabytes(bytesImagenes) << " MB para las imagenes y "
+                 << megabytes(bytesBuffers) << " MB para los arreglos que se conservan" << endl;
+    }
+
+    cacheImagenes imagenes;
+    imagenes.conservar(bytesImagenes);
+    poolBuffers buffers;
+    opcionesServicio.imagenes = &imagenes;
+    opcionesServicio.buffers = &buffers;
+    estadoServicio estado(pool, opcionesServicio, imagenes, buffers, bytesBuffers);
+
+    registro << "Servicio escuchando en " << ruta << endl;
+    while (!estado.detener && !senalDetener)
+    {
+        pollfd espera = {escucha, POLLIN, 0};
+        if (poll(&espera, 1, 200) <= 0)
+        {
+            continue;
+        }
+        int cliente = accept(escucha, nullptr, nullptr);
+        if (cliente < 0)
+        {
+            continue;
+        }
+
+        // Con MAX_CONEXIONES atendidas, la nueva espera (ya aceptada) a que termine alguna; las siguientes
+        // esperan en la cola del socket
+        unique_lock<mutex> bloqueo(estado.candado);
+        while (estado.activos >= MAX_CONEXIONES && !estado.detener && !senalDetener)
+        {
+            estado.terminoCliente.wait_for(bloqueo, chrono::milliseconds(200));
+        }
+        if (estado.activos >= MAX_CONEXIONES)
+        {
+            close(cliente);
+            break;
+        }
+        estado.clientes.push_back(cliente);
+        estado.activos++;
+        thread([cliente, &estado]() { atenderCliente(cliente, estado); }).detach();
+    }
+    close(escucha);
+    unlink(ruta.c_str());
+
+    // Las conexiones abiertas se cortan; cada una termina despues de responder la solicitud en curso
+    {
+        unique_lock<mutex> bloqueo(estado.candado);
+        estado.detener = true;
+        estado.terminoTrabajo.notify_all();
+        for (int cliente : estado.clientes)
+        {
+            shutdown(cliente, SHUT_RDWR);
+        }
+        estado.terminoCliente.wait(bloqueo, [&] { return estado.activos == 0; });
+    }
+
+    registro << "Servicio detenido: " << estado.estadisticas.resumen() << endl;
+    return true;
+#else
+    (void)rutaSocket;
+    (void)pool;
+    (void)opciones;
+    registro << "El modo servicio necesita sockets de dominio Unix (AF_UNIX), que no estan disponibles en este sistema" << endl;
+    return false;
+#endif
+}
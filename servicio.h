@@ -0,0 +1,27 @@
+#ifndef SERVICIO_H
+#define SERVICIO_H
+
+#include "reconstruccion.h"
+
+#include <QString>
+
+#include <ostream>
+
+class poolHilos;
+
+// Modo servicio: un proceso residente que atiende reconstrucciones por un socket local (AF_UNIX), con el
+// pool de hilos, el pool de buffers y las I_M decodificadas ya listos entre un caso y el siguiente.
+//
+// Protocolo: cada solicitud es una linea de texto y cada respuesta termina con una linea "OK ..." o
+// "ERROR ..."; antes pueden venir lineas "- ..." con los mensajes del caso (los que el modo normal
+// imprime en pantalla). Las rutas deben ser absolutas (o relativas al directorio del servicio).
+//
+//   RECONSTRUIR <directorio>        -> OK <directorio>/I_O.bmp <milisegundos>
+//   RECONSTRUIR_BYTES <directorio>  -> OK <bytes> <milisegundos>, seguido del BMP reconstruido
+//   ESTADISTICAS                    -> OK clave=valor ...
+//   DETENER                         -> OK, y el servicio deja de aceptar conexiones
+//
+// Por ejemplo: printf 'RECONSTRUIR /casos/c1\n' | nc -U /tmp/desafio.sock
+bool ejecutarServicio(const QString &rutaSocket, poolHilos &pool, const opcionesReconstruccion &opciones, std::ostream &registro);
+
+#endif // SERVICIO_H
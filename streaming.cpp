@@ -0,0 +1,142 @@
+#include "streaming.h"
+#include "buffers.h"
+#include "cadena.h"
+#include "codecbmp.h"
+#include "contexto.h"
+#include "memoria.h"
+#include "operaciones.h"
+#include "pool.h"
+#include "reconstruccion.h"
+
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+bool reconstruirStreaming(const QString &rutaDirectorio, const QString &archivoSalida, size_t presupuesto, poolHilos &pool, const opcionesReconstruccion &opciones)
+{
+    /*
+     * @brief Reconstruye la imagen original sin cargar nunca las imagenes completas en memoria.
+     *
+     * La reconstruccion se hace en dos fases:
+     *  1. Identificacion: de I_D e I_M se leen solo las ventanas de enmascaramiento de cada etapa
+     *     (ver identificarCadena).
+     *  2. Aplicacion: I_D e I_M se recorren por bloques de filas, a cada bloque se le aplica la cadena
+     *     compilada (ver cadenaCompilada) y el resultado se escribe fila por fila en 'archivoSalida'.
+     *
+     * @param rutaDirectorio Directorio con I_D.bmp, I_M.bmp, M.bmp y los archivos M<i>.txt o M<i>.bin.
+     * @param archivoSalida Ruta del BMP reconstruido.
+     * @param presupuesto Memoria maxima (en bytes) para los bloques de filas de I_D e I_M.
+     * @param pool Pool de hilos para identificar los candidatos y transformar los bloques.
+     * @param opciones Cache de operaciones, limite de memoria (que tambien acota 'presupuesto') y opciones del
+     *                 reporte; la cache de imagenes no se usa en este modo.
+     *
+     * @return true si la imagen se reconstruyo y se escribio; false en caso contrario (el motivo se
+     *         informa por cout).
+     *
+     * @note Solo se soportan BMP de 24 bits sin compresion, que son los que pueden leerse por filas.
+     */
+
+    // Con un limite de memoria, los bloques de filas usan lo que queda despues de los datos de enmascaramiento
+    necesidadMemoria necesidad = {0, 0, 0};
+    if (opciones.memoria != nullptr)
+    {
+        if (!estimarMemoria(rutaDirectorio, necesidad))
+        {
+            cout << "No se pudieron cargar los archivos de " << rutaDirectorio.toStdString() << endl;
+            return false;
+        }
+        if (necesidad.fija + 2 * necesidad.fila > opciones.memoria->total())
+        {
+            cout << "Memoria insuficiente: el caso necesita al menos " << megabytes(necesidad.fija + 2 * necesidad.fila) << " MB y el limite es de "
+                 << megabytes(opciones.memoria->total()) << " MB" << endl;
+            return false;
+        }
+        size_t disponible = opciones.memoria->total() - necesidad.fija;
+        presupuesto = presupuesto < disponible ? presupuesto : disponible;
+    }
+    size_t bloques = presupuesto < 2 * necesidad.imagen ? presupuesto : 2 * necesidad.imagen;
+    reservaMemoria reserva(opciones.memoria, necesidad.fija + bloques);
+
+    // Solo se cargan los archivos de enmascaramiento (con precarga, en otro hilo mientras se identifican las etapas)
+    contexto ctx;
+    imagenBMP archivoID;
+    imagenBMP archivoIM;
+    if (!ctx.cargar(rutaDirectorio, false, nullptr, opciones.precarga) || !archivoID.abrir(rutaDirectorio + "/I_D.bmp") || !archivoIM.abrir(rutaDirectorio + "/I_M.bmp"))
+    {
+        cout << "No se pudieron cargar los archivos de " << rutaDirectorio.toStdString() << endl;
+        return false;
+    }
+    if (archivoID.totalBytes() != ctx.totalBytes())
+    {
+        cout << "I_D e I_M no tienen el mismo tamaño" << endl;
+        return false;
+    }
+
+    // Cada bloque necesita una fila de I_D y una de I_M por cada fila de salida
+    const size_t bytesFila = (size_t)archivoID.ancho() * 3;
+    const int filasBloque = presupuesto / (2 * bytesFila) < (size_t)archivoID.alto() ? presupuesto / (2 * bytesFila) : archivoID.alto();
+    if (filasBloque == 0)
+    {
+        cout << "El presupuesto de memoria no alcanza para una fila: se necesitan al menos " << 2 * bytesFila << " bytes" << endl;
+        return false;
+    }
+
+    // Fase 1: identificacion de la cadena usando solo las ventanas de enmascaramiento
+    poolBuffers buffers;
+    vector<candidato> cadena;
+    lectorVentana leer = [&](size_t inicio, size_t bytes, unsigned char *ventana, unsigned char *ventanaIM) {
+        archivoID.copiarRangoRGB(inicio, bytes, ventana);
+        archivoIM.copiarRangoRGB(inicio, bytes, ventanaIM);
+    };
+    vector<mascaraCandidatos> consistentes;
+    vector<int> ganadores = identificarCadena(leer, ctx, buffers, cadena, &consistentes, opciones.operaciones);
+    if (!ctx.esperarEtapas())
+    {
+        cout << "No se pudieron cargar los archivos de " << rutaDirectorio.toStdString() << endl;
+        return false;
+    }
+    reportarCadena(ganadores, cout, opciones.reportarConsistentes ? &consistentes : nullptr);
+
+    cadenaCompilada compilada;
+    compilada.compilar(cadena);
+    bool usaIM = compilada.usaIM();
+
+    // Fase 2: se aplica la cadena por bloques de filas y se escribe la salida fila por fila
+    escritorBMP salida;
+    if (!salida.abrir(archivoSalida, archivoID.ancho(), archivoID.alto()))
+    {
+        cout << "No se pudo crear " << archivoSalida.toStdString() << endl;
+        return false;
+    }
+
+    unsigned char *bloque = buffers.obtener(filasBloque * bytesFila);
+    unsigned char *bloqueIM = usaIM ? buffers.obtener(filasBloque * bytesFila) : nullptr;
+    for (int y = 0; y < archivoID.alto(); y += filasBloque)
+    {
+        int filas = archivoID.alto() - y < filasBloque ? archivoID.alto() - y : filasBloque;
+        size_t bytes = filas * bytesFila;
+        archivoID.copiarRangoRGB(y * bytesFila, bytes, bloque);
+        if (usaIM)
+        {
+            archivoIM.copiarRangoRGB(y * bytesFila, bytes, bloqueIM);
+        }
+
+        // El bloque se reparte entre los hilos del pool
+        compilada.aplicar(bloque, bloque, bloqueIM, bytes, pool);
+
+        salida.escribirFilas(y, filas, bloque);
+    }
+    buffers.devolver(bloque);
+    if (bloqueIM != nullptr)
+    {
+        buffers.devolver(bloqueIM);
+    }
+
+    if (!salida.cerrar())
+    {
+        cout << "Ocurrio un error al escribir " << archivoSalida.toStdString() << endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,14 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include "reconstruccion.h"
+
+#include <QString>
+#include <cstddef>
+
+class poolHilos;
+
+bool reconstruirStreaming(const QString &rutaDirectorio, const QString &archivoSalida, size_t presupuesto, poolHilos &pool,
+                          const opcionesReconstruccion &opciones = opcionesReconstruccion());
+
+#endif // STREAMING_H
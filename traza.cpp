@@ -0,0 +1,219 @@
+#include "traza.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+struct evento
+{
+    const char *nombre;
+    int hilo;
+    long long inicio;   // Nanosegundos desde el inicio del programa
+    long long duracion; // Nanosegundos
+};
+
+// Tiempo total y cantidad de llamadas de cada alcance
+struct totalAlcance
+{
+    long long llamadas;
+    long long nanosegundos;
+};
+
+// Cantidad de eventos que se conservan para exportarJSON: en --servicio o en lotes largos la linea de
+// tiempo queda con los ultimos, y los totales por nombre siguen contando todos
+const size_t MAX_EVENTOS = 1 << 16;
+
+const chrono::steady_clock::time_point inicioPrograma = chrono::steady_clock::now();
+
+// Los alcances miden etapas y ventanas completas, no bytes: un bloqueo por alcance no se nota
+mutex candado;
+map<const char *, totalAlcance> totales; // Por puntero al nombre; totalizar une los literales repetidos
+vector<evento> eventos;                  // Anillo de a lo sumo MAX_EVENTOS eventos
+size_t siguienteEvento = 0;              // Posicion del anillo en que se escribe el proximo evento
+long long eventosDescartados = 0;
+map<int, long long> candidatosPorEtapa;
+atomic<int> siguienteHilo(0);
+atomic<long long> contadores[traza::CANTIDAD_CONTADORES];
+
+const char *nombresContadores[traza::CANTIDAD_CONTADORES] = {
+    "bytes leidos de archivos",
+    "bytes transformados",
+    "bytes verificados",
+    "candidatos consistentes",
+    "reservas de memoria",
+};
+
+long long ahora()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - inicioPrograma).count();
+}
+
+int idHilo()
+{
+    thread_local int id = ++siguienteHilo;
+    return id;
+}
+
+void registrar(const evento &e)
+{
+    lock_guard<mutex> bloqueo(candado);
+    totalAlcance &t = totales[e.nombre];
+    t.llamadas++;
+    t.nanosegundos += e.duracion;
+
+    if (eventos.size() < MAX_EVENTOS)
+    {
+        eventos.push_back(e);
+    }
+    else
+    {
+        eventos[siguienteEvento] = e;
+        eventosDescartados++;
+    }
+    siguienteEvento = (siguienteEvento + 1) % MAX_EVENTOS;
+}
+
+map<string, totalAlcance> totalizar()
+{
+    map<string, totalAlcance> porNombre;
+    lock_guard<mutex> bloqueo(candado);
+    for (const pair<const char *const, totalAlcance> &t : totales)
+    {
+        totalAlcance &suma = porNombre[t.first];
+        suma.llamadas += t.second.llamadas;
+        suma.nanosegundos += t.second.nanosegundos;
+    }
+    return porNombre;
+}
+}
+
+namespace traza
+{
+alcance::alcance(const char *nombre)
+    : nombre(nombre), inicio(ahora())
+{
+}
+
+alcance::~alcance()
+{
+    registrar({nombre, idHilo(), inicio, ahora() - inicio});
+}
+
+bool disponible()
+{
+    /*
+     * @brief Indica si el programa se compilo con la instrumentacion (DESAFIO_TRAZA).
+     */
+
+#ifdef DESAFIO_TRAZA
+    return true;
+#else
+    return false;
+#endif
+}
+
+void sumar(contador c, long long valor)
+{
+    contadores[c].fetch_add(valor, memory_order_relaxed);
+}
+
+void sumarEtapa(int etapa, long long candidatos)
+{
+    sumar(CANDIDATOS_CONSISTENTES, candidatos);
+    lock_guard<mutex> bloqueo(candado);
+    candidatosPorEtapa[etapa] += candidatos;
+}
+
+bool exportarJSON(const char *archivo)
+{
+    /*
+     * @brief Escribe la linea de tiempo en el formato de trazas de Chrome (chrome://tracing, Perfetto).
+     *
+     * Cada alcance es un evento completo ("ph": "X") en el hilo que lo ejecuto; solo estan los ultimos
+     * MAX_EVENTOS, y "eventos descartados" cuenta los anteriores. Los contadores y los candidatos
+     * consistentes por etapa van en "otherData".
+     *
+     * @param archivo Ruta del archivo JSON a escribir.
+     *
+     * @return true si el archivo se escribio; false en caso contrario.
+     *
+     * @note Debe llamarse cuando ningun hilo esta registrando eventos (al final del programa).
+     */
+
+    FILE *salida = fopen(archivo, "w");
+    if (salida == nullptr)
+    {
+        return false;
+    }
+
+    fprintf(salida, "{\"traceEvents\":[\n");
+    bool primero = true;
+    {
+        lock_guard<mutex> bloqueo(candado);
+        // Con el anillo lleno, el evento mas antiguo es el que se sobrescribe a continuacion
+        size_t primerEvento = eventos.size() < MAX_EVENTOS ? 0 : siguienteEvento;
+        for (size_t k = 0; k < eventos.size(); k++)
+        {
+            const evento &e = eventos[(primerEvento + k) % eventos.size()];
+            fprintf(salida, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", primero ? "" : ",\n", e.nombre, e.hilo, e.inicio / 1000.0, e.duracion / 1000.0);
+            primero = false;
+        }
+    }
+
+    fprintf(salida, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{");
+    for (int c = 0; c < CANTIDAD_CONTADORES; c++)
+    {
+        fprintf(salida, "\"%s\":%lld,", nombresContadores[c], contadores[c].load());
+    }
+    {
+        lock_guard<mutex> bloqueo(candado);
+        fprintf(salida, "\"eventos descartados\":%lld,\"candidatos por etapa\":{", eventosDescartados);
+        primero = true;
+        for (const pair<const int, long long> &e : candidatosPorEtapa)
+        {
+            fprintf(salida, "%s\"%d\":%lld", primero ? "" : ",", e.first, e.second);
+            primero = false;
+        }
+    }
+    fprintf(salida, "}}}\n");
+    return fclose(salida) == 0;
+}
+
+void imprimirResumen(ostream &salida)
+{
+    /*
+     * @brief Imprime una tabla con el tiempo total de cada alcance, los contadores y los candidatos por etapa.
+     */
+
+    char linea[160];
+    salida << "--- Resumen de la traza ---" << endl;
+    snprintf(linea, sizeof(linea), "%-28s %10s %12s %12s", "alcance", "llamadas", "total ms", "promedio ms");
+    salida << linea << endl;
+    for (const pair<const string, totalAlcance> &t : totalizar())
+    {
+        snprintf(linea, sizeof(linea), "%-28s %10lld %12.3f %12.4f", t.first.c_str(), t.second.llamadas, t.second.nanosegundos / 1e6, t.second.nanosegundos / 1e6 / t.second.llamadas);
+        salida << linea << endl;
+    }
+
+    for (int c = 0; c < CANTIDAD_CONTADORES; c++)
+    {
+        snprintf(linea, sizeof(linea), "%-28s %lld", nombresContadores[c], contadores[c].load());
+        salida << linea << endl;
+    }
+
+    lock_guard<mutex> bloqueo(candado);
+    for (const pair<const int, long long> &e : candidatosPorEtapa)
+    {
+        snprintf(linea, sizeof(linea), "candidatos en la etapa %-5d %lld", e.first, e.second);
+        salida << linea << endl;
+    }
+}
+}
@@ -0,0 +1,62 @@
+#ifndef TRAZA_H
+#define TRAZA_H
+
+#include <ostream>
+
+// Instrumentacion de tiempos y contadores. Solo se compila con DEFINES += DESAFIO_TRAZA (CONFIG += traza
+// en qmake); sin esa definicion las macros no generan codigo ni evaluan sus argumentos.
+//
+//  TRAZA_ALCANCE("nombre")        mide el tiempo hasta el final del bloque y lo suma al total del nombre
+//  TRAZA_SUMAR(traza::X, valor)   suma 'valor' al contador X
+//  TRAZA_ETAPA(etapa, valor)      suma 'valor' a los candidatos consistentes de la etapa
+//
+// Los nombres de los alcances deben ser literales (se guarda el puntero, no una copia). La memoria de la
+// traza no crece con la duracion del proceso: hay un total por nombre y la linea de tiempo que exporta
+// exportarJSON conserva solo los ultimos eventos.
+
+namespace traza
+{
+enum contador
+{
+    BYTES_LEIDOS,            // Bytes de archivos leidos o mapeados
+    BYTES_TRANSFORMADOS,     // Bytes a los que se aplico una operacion
+    BYTES_VERIFICADOS,       // Bytes comparados contra un archivo de enmascaramiento
+    CANDIDATOS_CONSISTENTES, // Candidatos consistentes con la ventana de cada etapa
+    RESERVAS,                // Reservas de memoria para imagenes, ventanas y datos de enmascaramiento
+    CANTIDAD_CONTADORES
+};
+
+class alcance
+{
+public:
+    explicit alcance(const char *nombre);
+    ~alcance();
+
+private:
+    alcance(const alcance &) = delete;
+    alcance &operator=(const alcance &) = delete;
+
+    const char *nombre;
+    long long inicio;
+};
+
+bool disponible();
+void sumar(contador c, long long valor);
+void sumarEtapa(int etapa, long long candidatos);
+bool exportarJSON(const char *archivo);
+void imprimirResumen(std::ostream &salida);
+}
+
+#ifdef DESAFIO_TRAZA
+#define TRAZA_CONCATENAR_(a, b) a##b
+#define TRAZA_CONCATENAR(a, b) TRAZA_CONCATENAR_(a, b)
+#define TRAZA_ALCANCE(nombre) traza::alcance TRAZA_CONCATENAR(trazaAlcance, __LINE__)(nombre)
+#define TRAZA_SUMAR(c, valor) traza::sumar(c, valor)
+#define TRAZA_ETAPA(etapa, valor) traza::sumarEtapa(etapa, valor)
+#else
+#define TRAZA_ALCANCE(nombre) ((void)0)
+#define TRAZA_SUMAR(c, valor) ((void)0)
+#define TRAZA_ETAPA(etapa, valor) ((void)0)
+#endif
+
+#endif // TRAZA_H